@@ -117,8 +117,28 @@ int ad_init_param(char *file)
     DU ipaddress port
     EBRUN runnr
     EBSIZE maxevents --> maximum number of events in a file
+    EBMBYTE mbyte --> start new files when one of them has mbyte MB, 0: no limit
+    EBTIME seconds --> start new files seconds after they were opened (wall clock), 0: no limit
+    EBGPSTIME seconds --> start new files when their events span seconds of GPS time, 0: no limit
     EBDIR datadir --> folder in which the data is stored
+    EBWAIT ms --> write an event at most ms milliseconds after its T3, also when not all DUs have answered
+    EBDIRECT flag --> 1: write the event files with direct I/O, bypassing the page cache (Linux only)
+    EBMEMORY mbyte --> memory (MB) in the event builder for event fragments waiting to be written
+    EBCOMPRESS nthreads --> compress the ADC traces in the event files (EVENTVERSIONPACK) with nthreads threads, between the builder and the writer, 0: no compression
     T3RAND randfrac --> one T2 in every randfrac events is raised to a T3
+    T3THREADS nthreads --> number of threads used to search for T3s
+    T3ALGO name --> trigger algorithm (multiplicity, neighbour or classes)
+    T3POS file --> station positions, lines with DUid x y (in m)
+    T3PLANE maxrms --> veto T3s that do not fit a plane wave within maxrms ns (0: no veto)
+    T3RECORD file --> record all T2 messages with their arrival time (for t3bench)
+    T3WAIT ms --> a DU without T2 messages for ms milliseconds no longer delays the T3 search
+    T3BUDGET rate burst --> at most rate T3 requests per second (on average) and burst at once for each DU (rate 0: no limit)
+                            a physics T3 for which fewer than T3STAT DUs have budget left is not sent
+    T3OFFSET file --> timing offset of each DU, lines with DUid offset (in ns), subtracted from the T2 times
+    T3LEARN fraction --> correct the offsets by fraction of the plane wave residual of each station in a T3 (0: off), without T3PLANE no T3 is vetoed
+    T3SHADOW nshift --> estimate the accidental T3 rate with nshift time shifted windows (0: off)
+    T3CLASS name mask need window nstat prescale --> trigger class for T3ALGO classes: at least nstat T2s with a trigger flag in mask
+                                                    within window ns, together having all flags in need; keep every prescale-th
  */
 int ad_init_param(char *file)
 {
@@ -150,9 +170,32 @@ int ad_init_param(char *file)
         if(strcmp(key,"EBSIZE") == 0){
             sscanf(line,"%s %d",key,&eb_max_evts);
         }
+        if(strcmp(key,"EBMBYTE") == 0){
+            sscanf(line,"%s %d",key,&eb_max_mbyte);
+        }
+        if(strcmp(key,"EBTIME") == 0){
+            sscanf(line,"%s %d",key,&eb_max_time);
+        }
+        if(strcmp(key,"EBGPSTIME") == 0){
+            sscanf(line,"%s %d",key,&eb_max_gps);
+        }
         if(strcmp(key,"EBDIR") == 0){
             sscanf(line,"%s %s",key,eb_dir);
         }
+        if(strcmp(key,"EBWAIT") == 0){
+            sscanf(line,"%s %d",key,&eb_wait);
+        }
+        if(strcmp(key,"EBDIRECT") == 0){
+            sscanf(line,"%s %d",key,&eb_direct);
+        }
+        if(strcmp(key,"EBMEMORY") == 0){
+            sscanf(line,"%s %d",key,&eb_memory);
+        }
+        if(strcmp(key,"EBCOMPRESS") == 0){
+            sscanf(line,"%s %d",key,&eb_compress);
+            if(eb_compress < 0) eb_compress = 0;
+            if(eb_compress > MAXPACKTHREADS) eb_compress = MAXPACKTHREADS;
+        }
       if(strcmp(key,"T3STAT") == 0){
           sscanf(line,"%s %d",key,&t3_stat);
       }
@@ -162,6 +205,46 @@ int ad_init_param(char *file)
        if(strcmp(key,"T3RAND") == 0){
             sscanf(line,"%s %d",key,&t3_rand);
         }
+      if(strcmp(key,"T3THREADS") == 0){
+          sscanf(line,"%s %d",key,&t3_threads);
+          if(t3_threads < 1) t3_threads = 1;
+          if(t3_threads > MAXT3THREADS) t3_threads = MAXT3THREADS;
+      }
+      if(strcmp(key,"T3ALGO") == 0){
+          sscanf(line,"%s %19s",key,t3_algo);
+      }
+      if(strcmp(key,"T3POS") == 0){
+          sscanf(line,"%s %79s",key,t3_posfile);
+      }
+      if(strcmp(key,"T3PLANE") == 0){
+          sscanf(line,"%s %d",key,&t3_plane);
+      }
+      if(strcmp(key,"T3RECORD") == 0){
+          sscanf(line,"%s %79s",key,t3_recfile);
+      }
+      if(strcmp(key,"T3WAIT") == 0){
+          sscanf(line,"%s %d",key,&t3_wait);
+      }
+      if(strcmp(key,"T3BUDGET") == 0){
+          sscanf(line,"%s %g %d",key,&t3_budget,&t3_burst);
+          if(t3_burst < 1) t3_burst = 1;
+      }
+      if(strcmp(key,"T3OFFSET") == 0){
+          sscanf(line,"%s %79s",key,t3_offfile);
+      }
+      if(strcmp(key,"T3LEARN") == 0){
+          sscanf(line,"%s %g",key,&t3_learn);
+      }
+      if(strcmp(key,"T3SHADOW") == 0){
+          sscanf(line,"%s %d",key,&t3_shadow);
+          if(t3_shadow < 0) t3_shadow = 0;
+          if(t3_shadow > MAXSHADOW) t3_shadow = MAXSHADOW;
+      }
+      if(strcmp(key,"T3CLASS") == 0 && n_t3class < MAXT3CLASS){
+          if(sscanf(line,"%s %19s %i %i %d %d %d",key,t3_class[n_t3class].name,&t3_class[n_t3class].mask,
+                    &t3_class[n_t3class].need,&t3_class[n_t3class].window,&t3_class[n_t3class].nstat,
+                    &t3_class[n_t3class].prescale) == 7) n_t3class++;
+      }
     }
     fclose(fp);
     if(tot_du == MAXDU) printf("Warning: Reading out the maximal number of du stations:%d\n",MAXDU);
@@ -176,6 +259,7 @@ int ad_init_param(char *file)
  - create the T3 shared memory
  - create event shared memory
  - create a shared memory for commands
+ - create a shared memory for the T3 latency histograms
  - spawn the T3 maker, event builder, interface to the detector units, graphical and command line  interfaces to the user
  */
 void ad_initialize(char *file)
@@ -201,6 +285,10 @@ void ad_initialize(char *file)
         printf("An error occured creating the Command buffer space\n");
         exit(-1);
     }
+    if(ad_shm_create(&shm_lat,1,(sizeof(AD_LATENCY)+1)/2) == ERROR){
+        printf("An error occured creating the Latency histograms\n");
+        exit(-1);
+    }
     pid_du = ad_spawn_du();
     pid_t3 = ad_spawn_t3();
     pid_eb = ad_spawn_eb();
@@ -210,7 +298,7 @@ void ad_initialize(char *file)
 /**
  void remove_shared_memory()
  
- removes all central DAQ shared memories: t2, t3, event builder and commands
+ removes all central DAQ shared memories: t2, t3, event builder, commands and latency
  */
 void remove_shared_memory()
 {
@@ -218,6 +306,7 @@ void remove_shared_memory()
     ad_shm_delete(&shm_t3);
     ad_shm_delete(&shm_eb);
     ad_shm_delete(&shm_cmd);
+    ad_shm_delete(&shm_lat);
 }
 
 /**
@@ -11,6 +11,7 @@ Altering the code without explicit consent of the author is forbidden
 #include <netinet/in.h>
 #include <arpa/inet.h>
 #include "ad_shm.h"
+#include "ad_hist.h"
 
 #define MAXDU 100 //max number of Detector Units
 #define ERROR -1
@@ -33,6 +34,13 @@ typedef struct{
 #define NT3BUF 500 // max 500 T3 buffers (small messages anyway)
 #define T3SIZE (6+3*MAXDU) //Max. size (in shorts) for T3 info in 1 message
 
+typedef struct{
+  AD_HIST t2_t3;                // us from the arrival of the first T2 to the T3 in shm_t3
+  AD_HIST t3_du;                // us from the T3 in shm_t3 to the requests sent to the DUs
+  uint32_t published[NT3BUF][2]; // time (sec, usec) each T3 buffer was filled
+}AD_LATENCY; // kept in shared memory (shm_lat)
+#define T3LATENCY ((AD_LATENCY *)shm_lat.Ubuf)
+
 #define NEVBUF 10 // maximal 10 event buffers
 #define EVSIZE 80000 //Max. size (in shorts) for evsize for each DU
 
@@ -42,6 +50,23 @@ typedef struct{
 
 #define TCOINC 2000  // Maximum coincidence time window
 #define NTRIG 2 //total at least 2 stations
+#define MAXT3THREADS 16 // maximal number of threads searching for T3s
+#define T3WAIT 1000 // a DU without T2s for 1000 ms does no longer delay T3s
+#define T3BURST 10 // T3 requests a DU can receive at once when the T3 requests are budgeted
+#define EBWAIT 2000 // an event is written 2000 ms after its T3, even when not all DUs have answered
+#define EBMEMORY 80 // MB of memory for the event fragments in the event builder
+#define MAXSHADOW 8 // maximal number of shifted windows for the accidental T3 rate
+#define MAXT3CLASS 8 // maximal number of trigger classes
+#define MAXPACKTHREADS 16 // maximal number of threads compressing events in the event builder
+
+typedef struct{
+  char name[20];
+  int mask;     // T2 trigger flags taking part (1: scintillator, 2: antenna)
+  int need;     // trigger flags that must all be present in the window (hybrid triggers)
+  int window;   // coincidence window (ns)
+  int nstat;    // minimal number of T2s in the window
+  int prescale; // only every prescale-th trigger is kept (0 or 1: all)
+}T3CLASS;
 
 
 #ifdef _MAINDAQ
@@ -51,15 +76,36 @@ shm_struct shm_t2;
 shm_struct shm_t3;
 shm_struct shm_cmd;
 shm_struct shm_eb;
+shm_struct shm_lat;
 //next EB parameters
 int eb_run = 1;
 int eb_run_mode = 0;
 int eb_max_evts = 10;
+int eb_max_mbyte = 0; // 0: no limit
+int eb_max_time = 0;
+int eb_max_gps = 0;
 char eb_dir[80];
+int eb_wait = EBWAIT;
+int eb_direct = 0;
+int eb_memory = EBMEMORY;
+int eb_compress = 0;
 //T3 parameters
 int t3_rand = 0; 
 int t3_stat = NTRIG;
 int t3_time = TCOINC;
+int t3_threads = 1;
+char t3_algo[20] = "multiplicity";
+int t3_plane = 0;
+char t3_posfile[80] = "";
+char t3_recfile[80] = "";
+int t3_wait = T3WAIT;
+float t3_budget = 0; // T3 requests per second for each DU (0: no limit)
+int t3_burst = T3BURST;
+char t3_offfile[80] = "";
+float t3_learn = 0;
+int t3_shadow = 0; // number of shifted windows for the accidental T3 rate (0: off)
+T3CLASS t3_class[MAXT3CLASS]; // trigger classes of the "classes" trigger algorithm
+int n_t3class = 0;
 #else
 extern DUInfo DUinfo[MAXDU];
 extern int tot_du;
@@ -67,11 +113,32 @@ extern shm_struct shm_t2;
 extern shm_struct shm_t3;
 extern shm_struct shm_eb;
 extern shm_struct shm_cmd;
+extern shm_struct shm_lat;
 extern int eb_run ;
 extern int eb_run_mode;
 extern int eb_max_evts ;
+extern int eb_max_mbyte;
+extern int eb_max_time;
+extern int eb_max_gps;
 extern char eb_dir[80]; 
+extern int eb_wait;
+extern int eb_direct;
+extern int eb_memory;
+extern int eb_compress;
 extern int t3_rand;
 extern int t3_stat;
 extern int t3_time;
+extern int t3_threads;
+extern char t3_algo[20];
+extern int t3_plane;
+extern char t3_posfile[80];
+extern char t3_recfile[80];
+extern int t3_wait;
+extern float t3_budget;
+extern int t3_burst;
+extern char t3_offfile[80];
+extern float t3_learn;
+extern int t3_shadow;
+extern T3CLASS t3_class[MAXT3CLASS];
+extern int n_t3class;
 #endif
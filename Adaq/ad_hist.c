@@ -0,0 +1,76 @@
+/***
+DAQ latency histograms
+Version:1.0
+Date: 19/10/2026
+ ***/
+#include <stdio.h>
+#include "ad_hist.h"
+
+/**
+ int ad_hist_bin(uint32_t value)
+ 
+ values below 2*HISTSUB have their own bin, above that HISTSUB bins for each power of 2
+ */
+int ad_hist_bin(uint32_t value)
+{
+  int shift = 0;
+  
+  while((value>>shift) >= 2*HISTSUB) shift++;
+  return(shift*HISTSUB+(value>>shift));
+}
+
+/**
+ uint32_t ad_hist_low(int bin)
+ 
+ lowest value in a bin
+ */
+uint32_t ad_hist_low(int bin)
+{
+  int shift = 0;
+  
+  if(bin >= 2*HISTSUB) shift = bin/HISTSUB-1;
+  return((uint32_t)(bin-shift*HISTSUB)<<shift);
+}
+
+/**
+ void ad_hist_add(AD_HIST *h,uint32_t value)
+ 
+ add a value to the histogram. There should be only one process filling a histogram
+ */
+void ad_hist_add(AD_HIST *h,uint32_t value)
+{
+  h->bin[ad_hist_bin(value)]++;
+  if(value > h->max) h->max = value;
+  h->count++;
+}
+
+/**
+ uint32_t ad_hist_value(AD_HIST *h,double fraction)
+ 
+ the value below which fraction of the entries are found (lowest value of that bin)
+ */
+uint32_t ad_hist_value(AD_HIST *h,double fraction)
+{
+  int i;
+  uint32_t n,sum = 0;
+  
+  if(h->count == 0) return(0);
+  n = fraction*h->count;
+  for(i=0;i<NHISTBIN;i++){
+    sum += h->bin[i];
+    if(sum > n) return(ad_hist_low(i));
+  }
+  return(h->max);
+}
+
+/**
+ void ad_hist_print(FILE *fp,char *name,AD_HIST *h)
+ 
+ one status line with the median, 90%, 99% and maximum in ms (the histogram contains us)
+ */
+void ad_hist_print(FILE *fp,char *name,AD_HIST *h)
+{
+  fprintf(fp,"%s (ms): 50%% %7.1f 90%% %7.1f 99%% %7.1f max %7.1f (%u)\n",name,
+          1.e-3*ad_hist_value(h,0.5),1.e-3*ad_hist_value(h,0.9),
+          1.e-3*ad_hist_value(h,0.99),1.e-3*h->max,h->count);
+}
@@ -0,0 +1,20 @@
+/***
+DAQ latency histograms
+Version:1.0
+Date: 19/10/2026
+ ***/
+#include <stdio.h>
+#include <stdint.h>
+
+#define HISTSUB 16 // bins for each power of 2 (values are known within 1/HISTSUB)
+#define NHISTBIN (HISTSUB*29) // covers all 32 bit values
+
+typedef struct{
+  uint32_t count;
+  uint32_t max;
+  uint32_t bin[NHISTBIN];
+}AD_HIST; // log-linear histogram, can be kept in shared memory
+
+void ad_hist_add(AD_HIST *h,uint32_t value);
+uint32_t ad_hist_value(AD_HIST *h,double fraction);
+void ad_hist_print(FILE *fp,char *name,AD_HIST *h);
@@ -498,6 +498,8 @@ void du_write()
   unsigned int ssec;
   int il,length;
   du_geteventbody *evtinfo= (du_geteventbody *)(&(get_t3event[3]));
+  struct timeval tnow;
+  struct timezone tzone;
   
   // read t3 request from memory and send to DU
   while((shm_t3.Ubuf[(*shm_t3.size)*(*shm_t3.next_read)])  !=  0){ // loop over the T3 input
@@ -523,6 +525,9 @@ void du_write()
         }
       }
       //if(loglevel >=3) printf("DU: Done sending T3 request\n");
+      gettimeofday(&tnow,&tzone);
+      ad_hist_add(&T3LATENCY->t3_du,(tnow.tv_sec-T3LATENCY->published[*shm_t3.next_read][0])*1000000
+                  +tnow.tv_usec-T3LATENCY->published[*shm_t3.next_read][1]);
       shm_t3.Ubuf[(*shm_t3.size)*(*shm_t3.next_read)] &= ~1;
     }
     *shm_t3.next_read = (*shm_t3.next_read) + 1;
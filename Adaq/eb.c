@@ -11,26 +11,41 @@
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <sys/time.h>
 #include "Adaq.h"
 #include "amsg.h"
 #include "eb.h"
 #include "scope.h"
+#include "evpack.h"
+#include "monrec.h"
 
 extern char *configfile;
 int ad_init_param(char *file);
 
-/* next lines copied from scope.h */
-#define FIRMWARE_VERSION(x) (10*((x>>20)&0xf)+((x>>16)&0xf))
-#define FIRMWARE_SUBVERSION(x)   (10*((x>>12)&0xf)+((x>>9)&0x7))
-#define SERIAL_NUMBER(x)    (100*((x>>8)&0x1)+10*((x>>4)&0xf)+((x>>0)&0xf))
+#define EBTIMEOUT 5 // need to have at least 5 seconds of data before writing (events without T3)
+#define NEBT3 65536 // T3 table, indexed by the 16 bit T3 event number
+#define EVT_GPS(ev) GPS_NS(*(uint32_t *)&(ev)[EVT_SECOND],*(uint32_t *)&(ev)[EVT_NANOSEC]) // time of a DU event
 
-#define NDU (5*MAXDU) // maximally 5 events for each DU in memory
-#define EBTIMEOUT 5 // need to have at least 5 seconds of data before writing
+typedef struct{
+  uint16_t t3_id;  // event number (EVT_ID)
+  GPSTIME time;    // GPS time of the fragment
+  int slot;        // the fragment in memory (eb_slab_alloc)
+}EBKEY;
+
+typedef struct{
+  int expected;   // number of DUs asked for data (0: no T3 known)
+  int answered;   // DU_EVENT and DU_NO_EVENT messages received
+  struct timeval arrival; // arrival of the T3 in the event builder
+}EBT3;
 
 int running = 0;
 
-uint16_t DUbuffer[NDU][EVSIZE];
-int i_DUbuffer = 0;
+EBKEY *eb_key = NULL; // index of the fragments in memory, sorted in reverse order (latest first)
+int n_key = 0; // size of the index
+int n_frag = 0; // number of fragments in memory
+EBT3 eb_t3[NEBT3]; // the T3s for which data is expected
+int eb_complete = 0; // events written when all DUs had answered
+int eb_timeout = 0;  // events written after eb_wait ms
 
 int eb_sub = 1; //file subnumber
 int eb_event = 0;
@@ -40,37 +55,66 @@ static int write_sub[3]={0,0,0};
 
 
 FILEHDR eb_fhdr;
-FILE *fpout = NULL,*fpten=NULL,*fpmon=NULL,*fpmb=NULL;
+EBFILE *fpout = NULL,*fpten=NULL,*fpmb=NULL;
+EBFILE *fpmon=NULL;
+off_t eb_filebytes[EBNSTREAM]; // bytes written in the current file of each event stream (estimated when compressing)
+off_t eb_filesize[EBNSTREAM];  // expected size of a full file, from the previous file
+struct timeval eb_opened;      // wall clock time at which the current files were opened
+
+/**
+ void eb_mon_header(FILEHDR *fhdr)
+ 
+ the file header of the MON file: that of the event files, with add1 MONMAGIC and add2 the size of a record
+ */
+void eb_mon_header(FILEHDR *fhdr)
+{
+  memcpy(fhdr,&eb_fhdr,sizeof(FILEHDR));
+  fhdr->add1 = MONMAGIC;
+  fhdr->add2 = sizeof(MONREC);
+}
 
 /**
  void eb_open(EVHDR *evhdr)
  
- opens different event streams
+ opens different event streams, and the file with monitoring records
  writes the file headers
+ The event files are opened by the writer thread, with direct I/O they get eb_filesize bytes reserved
  */
 void eb_open(EVHDR *evhdr)
 {
   char fname[100];
+  FILE *fp;
+  FILEHDR monhdr;
+  int stream;
+  off_t prealloc[EBNSTREAM];
+  struct timezone tz;
   
   printf("Trying to open eventfiles\n");
   sprintf(fname,"%s/AD/ad%06d.f%04d",eb_dir,eb_run,eb_sub);
-  fpout = fopen(fname,"r");
-  while(fpout != NULL){
+  fp = fopen(fname,"r");
+  while(fp != NULL){
+    fclose(fp);
     eb_sub +=1;
     if(eb_sub>9999){
       eb_sub = 1;
       eb_run++;
     }
     sprintf(fname,"%s/AD/ad%06d.f%04d",eb_dir,eb_run,eb_sub);
-    fpout = fopen(fname,"r");
+    fp = fopen(fname,"r");
   }
-  fpout = fopen(fname,"w");
+  for(stream=0;stream<EBNSTREAM;stream++){
+    prealloc[stream] = eb_filesize[stream];
+    eb_filebytes[stream] = 0;
+  }
+  if(prealloc[0] == 0) prealloc[0] = (off_t)eb_max_evts*EBEVGUESS;
+  fpout = eb_writer_open(fname,prealloc[0]);
   sprintf(fname,"%s/TD/td%06d.f%04d",eb_dir,eb_run,eb_sub);
-  fpten = fopen(fname,"w");
+  fpten = eb_writer_open(fname,prealloc[1]);
   sprintf(fname,"%s/MD/md%06d.f%04d",eb_dir,eb_run,eb_sub);
-  fpmb = fopen(fname,"w");
+  fpmb = eb_writer_open(fname,prealloc[2]);
   sprintf(fname,"%s/MON/MO%06d.f%04d",eb_dir,eb_run,eb_sub);
-  fpmon = fopen(fname,"w");
+  fpmon = eb_writer_open(fname,0);
+  gettimeofday(&eb_opened,&tz);
   // next write file header
   eb_fhdr.length = sizeof(FILEHDR)-sizeof(int32_t);
   eb_fhdr.run_id = eb_run;
@@ -82,70 +126,172 @@ void eb_open(EVHDR *evhdr)
   eb_fhdr.last_event_time = evhdr->seconds;
   eb_fhdr.add1 = 0;
   eb_fhdr.add2 = 0;
-  fwrite(&eb_fhdr,1,sizeof(FILEHDR),fpout);
-  fwrite(&eb_fhdr,1,sizeof(FILEHDR),fpten);
-  fwrite(&eb_fhdr,1,sizeof(FILEHDR),fpmb);
+  eb_put(0,fpout,&eb_fhdr,sizeof(FILEHDR),-1);
+  eb_put(1,fpten,&eb_fhdr,sizeof(FILEHDR),-1);
+  eb_put(2,fpmb,&eb_fhdr,sizeof(FILEHDR),-1);
+  eb_mon_header(&monhdr);
+  eb_put(EBMON,fpmon,&monhdr,sizeof(FILEHDR),-1);
 }
 
 /**
  void eb_close()
  
  Closes the different file streams and run a monitoring program on the files
+ The event files are closed by the writer thread, after their last data, the index of their events (evindex.h)
+ and the updated file header are written
+ The size of a full file is estimated for the preallocation of the next files:
+ from the number of events, or, when files also end in time, the size of this file
  */
 void eb_close()
 {
   char cmd[400];
-  // first update file header
-  rewind(fpout);
-  fwrite(&eb_fhdr,1,sizeof(FILEHDR),fpout);
-  fclose(fpout);
-  rewind(fpten);
-  fwrite(&eb_fhdr,1,sizeof(FILEHDR),fpten);
-  fclose(fpten);
-  rewind(fpmb);
-  fwrite(&eb_fhdr,1,sizeof(FILEHDR),fpmb);
-  fclose(fpmb);
-  fclose(fpmon);
+  FILEHDR monhdr;
+  int stream,nevt = 0;
+
+  for(stream=0;stream<EBNSTREAM;stream++) nevt += write_sub[stream];
+  if(nevt > 0){
+    for(stream=0;stream<EBNSTREAM;stream++){
+      if(eb_max_time > 0 || eb_max_gps > 0) eb_filesize[stream] = eb_filebytes[stream];
+      else eb_filesize[stream] = eb_filebytes[stream]*eb_max_evts/nevt;
+      if(eb_max_mbyte > 0 && eb_filesize[stream] > (off_t)eb_max_mbyte*1024*1024)
+        eb_filesize[stream] = (off_t)eb_max_mbyte*1024*1024;
+    }
+  }
+  // first update file header, the writer adds the position of the index of the events
+  eb_put_close(0,fpout,&eb_fhdr);
+  eb_put_close(1,fpten,&eb_fhdr);
+  eb_put_close(2,fpmb,&eb_fhdr);
+  eb_mon_header(&monhdr);
+  eb_put_close(EBMON,fpmon,&monhdr);
   fpout = NULL;
   fpten = NULL;
   fpmb = NULL;
   fpmon = NULL;
+  eb_sub +=1; // the writer may not have made the files yet, eb_open can not see they exist
+  if(eb_sub>9999){
+    eb_sub = 1;
+    eb_run++;
+  }
+}
+
+/**
+ int eb_file_full(EVHDR *evhdr,int nevt)
+ 
+ should the current files be closed after nevt events, the last with header evhdr (NULL: only the time is checked)?
+ That is after eb_max_evts events, when one file has eb_max_mbyte MB, when the events span eb_max_gps GPS seconds,
+ or eb_max_time seconds after the files were opened, whichever comes first
+ */
+int eb_file_full(EVHDR *evhdr,int nevt)
+{
+  struct timeval tnow;
+  struct timezone tz;
+  int stream;
+  
+  if(fpout == NULL) return(0);
+  if(nevt >= eb_max_evts) return(1);
+  for(stream=0;stream<EBNSTREAM;stream++)
+    if(eb_max_mbyte > 0 && eb_filebytes[stream] >= (off_t)eb_max_mbyte*1024*1024) return(1);
+  if(evhdr != NULL && eb_max_gps > 0 && evhdr->seconds >= eb_fhdr.first_event_time+eb_max_gps) return(1);
+  if(eb_max_time > 0){
+    gettimeofday(&tnow,&tz);
+    if(tnow.tv_sec-eb_opened.tv_sec >= eb_max_time) return(1);
+  }
+  return(0);
 }
 
 /**
- int eb_DUcompare(const void *a, const void *b)
+ int eb_keycompare(EBKEY *k1,EBKEY *k2)
  
  routine used for sorting
  a<b return 1
  a>b return -1
  --> reverse ordering
+ The 16 bit event numbers wrap: an event number is older than the 32767 numbers that follow it
  */
-int eb_DUcompare(const void *a, const void *b)
+int eb_keycompare(EBKEY *k1,EBKEY *k2)
 { /* sorting in REVERSE order, easy removal of older data */
-  uint16_t  *t1,*t2;
-  uint32_t t1sec,t2sec;
-  uint32_t t1nsec,t2nsec;
-  t1 = (uint16_t *)(a);
-  t2 = (uint16_t *)(b);
-  if(t1[EVT_ID] < t2[EVT_ID]) {
-    if((t1[EVT_ID]+1000) < t2[EVT_ID]) return(-1);
-    else return(1);
+  if(EVNR_DIFF(k1->t3_id,k2->t3_id) < 0) return(1);
+  if(EVNR_DIFF(k1->t3_id,k2->t3_id) > 0) return(-1);
+  if(k1->time < k2->time) return(1);
+  if(k1->time > k2->time) return(-1);
+  return(0);
+}
+
+/**
+ void eb_release(int first)
+ 
+ remove the fragments first and older from the index, and free their memory.
+ eb_release(0) also reserves the memory (eb_memory MB) the first time
+ */
+void eb_release(int first)
+{
+  int i;
+  
+  if(first == 0){ // all memory free
+    eb_writer_sync();
+    if(eb_slab_init(eb_memory) == ERROR) exit(-1);
+    if(eb_key == NULL){
+      n_key = eb_slab_maxfrag();
+      eb_key = (EBKEY *)malloc(n_key*sizeof(EBKEY));
+      if(eb_key == NULL){
+        printf("EB: Cannot make the index of the event fragments\n");
+        exit(-1);
+      }
+    }
+    n_frag = 0;
+    return;
   }
-  if(t1[EVT_ID] > t2[EVT_ID]) {
-    if(t1[EVT_ID] > (t2[EVT_ID]+1000)) return(1);
-    else return(-1);
+  for(i=first;i<n_frag;i++) eb_slab_free(&eb_key[i].slot,1);
+  n_frag = first;
+}
+
+/**
+ void eb_remove(int first,int last)
+ 
+ remove the fragments first..last from the index after they are handed to the writer.
+ Their memory is freed by the writer thread once they are written
+ */
+void eb_remove(int first,int last)
+{
+  memmove(&eb_key[first],&eb_key[last+1],(n_frag-last-1)*sizeof(EBKEY));
+  n_frag -= (last-first+1);
+}
+
+/**
+ void eb_insert(uint16_t *DUinfo)
+ 
+ copy a fragment into a block of memory of its size, and insert its key in the sorted index.
+ The fragment itself is never moved afterwards, only the (small) keys are.
+ With pack threads the block has room for the 2 words a packed fragment may need more (eb_pack_buffer)
+ */
+void eb_insert(uint16_t *DUinfo)
+{
+  EBKEY key;
+  int lo,hi,mid;
+  size_t length = 2*(DUinfo[EVT_LENGTH]+(eb_writer_packing() ? 2 : 0));
+  
+  key.slot = eb_slab_alloc(length);
+  if(key.slot < 0){ // the memory waits to be written: wait for the disk
+    eb_writer_sync();
+    key.slot = eb_slab_alloc(length);
+    if(key.slot < 0){
+      printf("EB: No memory for an event fragment\n");
+      return;
+    }
   }
-  t1sec = *(uint32_t *)&t1[EVT_SECOND];
-  t1nsec = *(uint32_t *)&t1[EVT_NANOSEC];
-  t2sec = *(uint32_t *)&t2[EVT_SECOND];
-  t2nsec = *(uint32_t *)&t2[EVT_NANOSEC];
-  if(t1sec < t2sec) return(1);
-  if(t1sec == t2sec){
-    if(t1nsec < t2nsec) return(1);
-    else if(t2nsec < t1nsec) return(-1);
-    else return(0);
+  key.t3_id = DUinfo[EVT_ID];
+  key.time = EVT_GPS(DUinfo);
+  memcpy((void *)eb_slab_data(key.slot),(void *)DUinfo,2*DUinfo[EVT_LENGTH]);
+  lo = 0;
+  hi = n_frag;
+  while(lo < hi){ // the new key goes after all keys that are not older
+    mid = (lo+hi)/2;
+    if(eb_keycompare(&eb_key[mid],&key) <= 0) lo = mid+1;
+    else hi = mid;
   }
-  return(-1);
+  memmove(&eb_key[lo+1],&eb_key[lo],(n_frag-lo)*sizeof(EBKEY));
+  eb_key[lo] = key;
+  n_frag++;
 }
 
 /**
@@ -170,7 +316,7 @@ void eb_getui()
         ad_init_param(configfile);
         printf("EB: Starting the run\n");
         running = 1;
-        i_DUbuffer = 0; // get rid of old data
+        eb_release(0); // get rid of old data
         eb_sub = 1;
       }
       shm_cmd.Ubuf[(*shm_cmd.size)*(*shm_cmd.next_readb)] &= ~2;
@@ -181,9 +327,35 @@ void eb_getui()
 }
 
 /**
- void eb_gett3i()
+ void eb_t3_expect(T3BODY *T3info,int n_t3_du)
+ 
+ keep the number of DUs that will answer a T3: the stations in the list that are read out by this DAQ,
+ or all DUs for DU_id 0
+ */
+void eb_t3_expect(T3BODY *T3info,int n_t3_du)
+{
+  EBT3 *t3 = &eb_t3[T3info->event_nr];
+  int it3,il;
+  struct timezone tz;
+  
+  t3->expected = 0;
+  t3->answered = 0;
+  for(it3=0;it3<n_t3_du;it3++){
+    if(T3info->t3station[it3].DU_id == 0) t3->expected += tot_du;
+    else if(tot_du == 0) t3->expected++;
+    else{
+      for(il=0;il<tot_du;il++){
+        if(T3info->t3station[it3].DU_id == DUinfo[il].DUid) t3->expected++;
+      }
+    }
+  }
+  gettimeofday(&t3->arrival,&tz);
+}
+
+/**
+ void eb_gett3()
  get data from the T3 Maker
- Information is not used. We could remove this aspect!
+ the DUs in the T3 list are expected to answer with DU_EVENT or DU_NO_EVENT
  */
 void eb_gett3(){
   AMSG *msg;
@@ -196,6 +368,7 @@ void eb_gett3(){
       T3info = (T3BODY *)(&(msg->body[0])); //set the T3 info pointer
       n_t3_du = (msg->length-3)/T3STATIONSIZE; // msg == length+tag+eventnr+T3stations
       //printf("EB: T3 event = %d; NDU = %d \n",T3info->event_nr,n_t3_du);
+      if(running == 1) eb_t3_expect(T3info,n_t3_du);
       shm_t3.Ubuf[(*shm_t3.size)*(*shm_t3.next_readb)] &= ~2;
     }
     *shm_t3.next_readb = (*shm_t3.next_readb) + 1;
@@ -207,145 +380,145 @@ void eb_gett3(){
  void eb_getdata()
  
  interpret the data from the detector units
- copy events into a local buffer (DUbuffer)
- write monitoring informatie into an ASCII file (fpmon); also when there is no run!
- sort the event fragments in memory (latest first)
+ copy events into local memory (eb_slab_alloc)
+ write the monitoring information as records (monrec.h) into the MON file (fpmon), through the writer thread; also when there is no run!
+ keep an index of the event fragments in memory sorted (latest first)
  */
 void eb_getdata(){
   AMSG *msg;
   uint16_t *DUinfo;
-  int inew=0;
-  int firmware;
+  MONREC monrec;
   
   while(((shm_eb.Ubuf[(*shm_eb.size)*(*shm_eb.next_read)]) &1) ==  1){ // loop over the input
     //printf("EB: Get Data %d %d\n",*shm_eb.next_read,shm_eb.Ubuf[(*shm_eb.size)*(*shm_eb.next_read)]);
-    if(i_DUbuffer >= NDU) {
+    if(n_frag >= n_key) {
       printf("EB: Cannot accept more data\n");
       break;
     }
-    inew = 1;
     msg = (AMSG *)(&(shm_eb.Ubuf[(*shm_eb.size)*(*shm_eb.next_read)+1]));
     //printf("EB getdata: loop over input. TAG = %d\n",msg->tag);
     if(msg->tag == DU_EVENT){
       DUinfo = (uint16_t *)msg->body;
-      printf("Trying to copy event of length %d (max is %d)\n",DUinfo[EVT_LENGTH],EVSIZE);
       if(DUinfo[EVT_LENGTH] < EVSIZE){
-	if(i_DUbuffer < NDU) memcpy((void *)&DUbuffer[i_DUbuffer],(void *)DUinfo,2*DUinfo[EVT_LENGTH]);
-	if(running ==1) i_DUbuffer +=1;
+	if(running ==1) eb_insert(DUinfo);
       }
+      if(running == 1) eb_t3[DUinfo[EVT_ID]].answered++;
+    } else if(msg->tag == DU_NO_EVENT){
+      if(running == 1) eb_t3[((ls_no_eventbody *)msg->body)->event_nr].answered++;
     } else if(msg->tag == DU_MONITOR){
       if(fpmon != NULL){
-        memcpy(&firmware,&msg->body[1],4);
-        fprintf(fpmon,"%03d %03d %5d %d %4d %4d %4d %4d %4d %5.2f %5.2f %5.2f %d\n",DUPOS(msg->body[0]),
-                SERIAL_NUMBER(firmware),
-                1000*FIRMWARE_VERSION(firmware)+FIRMWARE_SUBVERSION(firmware),
-                *(int *)&msg->body[3],msg->body[5],
-                msg->body[6],msg->body[7],msg->body[8],msg->body[9],
-                *(float *)&msg->body[10],
-                *(float *)&msg->body[12],*(float *)&msg->body[14],msg->body[16]);
+        mon_record(msg->body,&monrec);
+        eb_put(EBMON,fpmon,&monrec,sizeof(MONREC),-1);
       }
     }
     shm_eb.Ubuf[(*shm_eb.size)*(*shm_eb.next_read)] = 0;
     *shm_eb.next_read = (*shm_eb.next_read) + 1;
     if( *shm_eb.next_read >= *shm_eb.nbuf) *shm_eb.next_read = 0;
   }
-  if(i_DUbuffer >= NDU) i_DUbuffer = NDU-1;
-  if(i_DUbuffer>0 && inew == 1) {
-    qsort(DUbuffer[0],i_DUbuffer,2*EVSIZE,eb_DUcompare);
-  }
+  if(n_frag >= n_key) eb_release(n_key-1);
 }
 
 /**
- void eb_write_events()
- 
- write events to disk
+ void eb_write_event(int first,int last)
  
- check if there is any buffer in memory
- create an event header
- check how many segments should be added to the event
+ write the fragments first..last (one event, last is the oldest fragment) in the proper event stream
  open the data files when needed
- write the event in the proper event stream
- make a new event header
+ remove the fragments from memory
  */
-void eb_write_events(){
-  FILE *fp;
+void eb_write_event(int first,int last)
+{
+  EBFILE *fp;
   EVHDR evhdr;
   uint16_t *DUinfo,*DUn;
-  int i,ils,il_start;
+  int ils;
   static int n_written=0;
   
-  if(i_DUbuffer == 0) return; //no buffers in memory
-  //printf("EB: A buffer in memory\n");
-  DUinfo = (uint16_t *)DUbuffer[i_DUbuffer-1];
-  il_start = i_DUbuffer-1;
-  DUn = (uint16_t *)DUbuffer[0];
-  if((*(uint32_t *)&DUn[EVT_SECOND]<=*(uint32_t *)&DUinfo[EVT_SECOND])  &&(i_DUbuffer < (0.8*NDU)))  return; //in case of a huge amount of data in 1 sec
-  if(((*(uint32_t *)&DUn[EVT_SECOND]-*(uint32_t *)&DUinfo[EVT_SECOND])<EBTIMEOUT) &&(i_DUbuffer < (0.8*NDU)) ) return;
+  DUinfo = eb_slab_data(eb_key[last].slot);
   evhdr.t3_id = DUinfo[EVT_ID];
-  evhdr.DU_count = 1;
-  evhdr.length = 40+2*DUinfo[EVT_LENGTH];
+  evhdr.DU_count = 0;
+  evhdr.length = 40;
   evhdr.run_id = eb_run;
   evhdr.event_id = eb_event;
   evhdr.first_DU = DUinfo[EVT_HARDWARE];
   evhdr.seconds = *(uint32_t *)&DUinfo[EVT_SECOND];
   evhdr.nanosec = *(uint32_t *)&DUinfo[EVT_NANOSEC];
-  evhdr.type = DUinfo[EVT_T3FLAG];
-  evhdr.version=EVENTVERSION;
-  //printf("Event Type %d Version %d\n",evhdr.type,evhdr.version);
-  for(i=(i_DUbuffer-2);i>=0;i--){
-    DUn = (uint16_t *)DUbuffer[i];
-    if(DUn[EVT_ID] == evhdr.t3_id){
-      evhdr.DU_count ++;
-      evhdr.length += 2*DUn[EVT_LENGTH];
-      evhdr.type |= DUn[EVT_T3FLAG];
-    }else{
-      //printf("EB: Found event %d with %d DU Length = %d (%d, %d %d)\n",evhdr.t3_id,evhdr.DU_count,evhdr.length,i_DUbuffer,DUn->GPSseconds,DUinfo->GPSseconds);
-      eb_fhdr.last_event_id = evhdr.event_id;
-      eb_fhdr.last_event_time = evhdr.seconds;
-      if(fpout == NULL) {
-        eb_open(&evhdr);
-        n_written = 0;
-        for(isub=0;isub<3;isub++) write_sub[isub] = 0;
-      }
-      isub = 0;
-      if((evhdr.type &TRIGGER_T3_MINBIAS) != 0){ // untriggered
-        fp = fpten;
-        isub = 1;
-      }
-      else{
-        if((evhdr.type& TRIGGER_T3_RANDOM) != 0) {
-          fp=fpmb; //single station triggered
-          isub = 2;
-        }
-        else fp = fpout;
-      }
-      fwrite(&evhdr,1,44,fp);
-      for(ils=il_start;ils>(il_start-evhdr.DU_count);ils--){
-        DUn = (uint16_t *)DUbuffer[ils];
-        fwrite(DUn,1,2*DUn[EVT_LENGTH],fp);
-        *(uint32_t *)&DUn[EVT_SECOND] = 0;
-      }// that is it, start a new event
-      n_written++;
-      write_sub[isub]++;
-      if(n_written >=eb_max_evts) eb_close();
-      eb_event++;
-      DUinfo = (uint16_t *)DUbuffer[i];
-      DUn = (uint16_t *)DUbuffer[0];
-      il_start = i;
-      i_DUbuffer = i+1;
-      if(((*(uint32_t *)&DUn[EVT_SECOND]-*(uint32_t *)&DUinfo[EVT_SECOND])<EBTIMEOUT) &&(i_DUbuffer < (0.8*NDU))) break;
-      evhdr.t3_id = DUinfo[EVT_ID];
-      evhdr.DU_count = 1;
-      evhdr.length = 40+2*DUinfo[EVT_LENGTH];
-      evhdr.run_id = eb_run;
-      evhdr.event_id = eb_event;
-      evhdr.first_DU = DUinfo[EVT_HARDWARE];
-      evhdr.seconds = *(uint32_t *)&DUinfo[EVT_SECOND];
-      evhdr.nanosec = *(uint32_t *)&DUinfo[EVT_NANOSEC];
-      evhdr.type = DUinfo[EVT_T3FLAG];
-      evhdr.version=EVENTVERSION;
+  evhdr.type = 0;
+  evhdr.version = eb_writer_packing() ? EVENTVERSIONPACK : EVENTVERSION;
+  for(ils=last;ils>=first;ils--){
+    DUn = eb_slab_data(eb_key[ils].slot);
+    evhdr.DU_count ++;
+    evhdr.length += 2*DUn[EVT_LENGTH];
+    evhdr.type |= DUn[EVT_T3FLAG];
+  }
+  eb_fhdr.last_event_id = evhdr.event_id;
+  eb_fhdr.last_event_time = evhdr.seconds;
+  if(fpout == NULL) {
+    eb_open(&evhdr);
+    n_written = 0;
+    for(isub=0;isub<3;isub++) write_sub[isub] = 0;
+  }
+  isub = 0;
+  if((evhdr.type &TRIGGER_T3_MINBIAS) != 0){ // untriggered
+    fp = fpten;
+    isub = 1;
+  }
+  else{
+    if((evhdr.type& TRIGGER_T3_RANDOM) != 0) {
+      fp=fpmb; //single station triggered
+      isub = 2;
     }
+    else fp = fpout;
+  }
+  eb_put_event(isub,fp,&evhdr);
+  if(eb_writer_packing()) eb_filebytes[isub] += (off_t)(eb_writer_ratio()*(evhdr.length+4)); // compressed by the pack threads
+  else eb_filebytes[isub] += evhdr.length+4;
+  for(ils=last;ils>=first;ils--){
+    DUn = eb_slab_data(eb_key[ils].slot);
+    eb_put(isub,fp,DUn,2*DUn[EVT_LENGTH],eb_key[ils].slot);
+  }
+  n_written++;
+  write_sub[isub]++;
+  if(eb_file_full(&evhdr,n_written)) eb_close();
+  eb_event++;
+  eb_remove(first,last);
+}
+
+/**
+ void eb_write_events()
+ 
+ write events to disk
+ 
+ an event is written as soon as all DUs in its T3 have answered,
+ or eb_wait ms after the T3 arrived (DUs that never answer).
+ Fragments without a known T3 are written when there are at least EBTIMEOUT seconds of newer data.
+ When the memory is almost full the oldest events are written anyway.
+ */
+void eb_write_events(){
+  EBT3 *t3;
+  struct timeval tnow;
+  struct timezone tz;
+  int i,first,write;
+  
+  gettimeofday(&tnow,&tz);
+  for(i=n_frag-1;i>=0;i=first-1){
+    for(first=i;first>0 && eb_key[first-1].t3_id == eb_key[i].t3_id;first--);
+    t3 = &eb_t3[eb_key[i].t3_id];
+    write = 0;
+    if(t3->expected > 0){
+      if(t3->answered >= t3->expected){
+        write = 1;
+        eb_complete++;
+      }else if((tnow.tv_sec-t3->arrival.tv_sec)*1000+(tnow.tv_usec-t3->arrival.tv_usec)/1000 >= eb_wait){
+        write = 1;
+        eb_timeout++;
+      }
+    }else if(first > 0 && GPS_SEC(eb_key[0].time)-GPS_SEC(eb_key[i].time) >= EBTIMEOUT) write = 1;
+    if(i == n_frag-1 && first > 0 && (n_frag >= (0.8*n_key) || eb_slab_usage() >= 0.8)) write = 1; //in case of a huge amount of data
+    if(write == 0) continue;
+    t3->expected = 0; // late answers are handled as fragments without T3
+    eb_write_event(first,i);
   }
+  if(eb_slab_usage() > 0.75) eb_writer_flush(); // release the memory of the written events soon
 }
 /**
  void eb_main()
@@ -364,16 +537,23 @@ void eb_main()
   sprintf(fname,"%s/eb",LOG_FOLDER);
   fp_log = fopen(fname,"w");
   printf("Starting EB\n");
+  eb_release(0);
+  if(eb_writer_start() == ERROR) exit(-1);
   while(1) {
     fseek(fp_log,0,SEEK_SET);
     eb_getui();
     eb_gett3();
     eb_getdata();
     if(running == 1) eb_write_events();
+    if(eb_file_full(NULL,0)) eb_close(); // files that have been open long enough, also without new events
+    eb_writer_idle();
     fprintf(fp_log,"To Disk: Run %6d, file %4d\n",eb_run,eb_sub);
     fprintf(fp_log,"AD events: %5d\n",write_sub[0]);
     fprintf(fp_log,"MD events: %5d\n",write_sub[2]);
     fprintf(fp_log,"TD events: %5d\n",write_sub[1]);
+    fprintf(fp_log,"Complete events: %d, after timeout: %d, fragments in memory: %d (%.0f%% of %d MB)\n",
+            eb_complete,eb_timeout,n_frag,100*eb_slab_usage(),eb_memory);
+    eb_writer_print(fp_log);
     usleep(1000);
   }
   fclose(fp_log);
@@ -7,8 +7,11 @@ Author: Charles Timmermans, Nikhef/Radboud University
 Altering the code without explicit consent of the author is forbidden
  ***/
 #include <unistd.h>
+#include <stdio.h>
+#include <sys/time.h>
+#include <sys/uio.h>
 
-#define EVENTVERSION 3
+#define EVENTVERSION 3 // fragments as sent by the DUs, EVENTVERSIONPACK (evpack.h) with compressed traces
 
 typedef struct{
   uint32_t length;
@@ -39,3 +42,87 @@ typedef struct{
   uint16_t DUdata[];
 }EVHDR;
 
+
+#define EBNSTREAM 3 // event streams: AD, TD and MD
+#define EBMON EBNSTREAM // stream of the monitoring records (MON files, monrec.h)
+#define EBNOUT (EBNSTREAM+1) // streams written by the writer thread
+#define EBNBUF 8 // batches of events handed to the writer thread
+#define EBNIOV 256 // pieces (headers and fragments) in a batch, at most IOV_MAX
+#define EBBUFSIZE (4*1024*1024) // a batch is written when it has at least this many bytes
+#define EBHDRSIZE (EBNIOV*sizeof(EVHDR)) // space for copies of the headers in a batch
+#define EBFLUSH 200 // a batch is written when it was started more than 200 ms ago
+#define EBALIGN 4096 // direct I/O: alignment of memory, file offsets and lengths
+#define EBEVGUESS (64*1024) // direct I/O: bytes per event assumed to preallocate the first file
+#define EBPAGE (1024*1024) // the fragment memory is divided in pages of 1 MB
+#define EBMINBLOCK 512 // smallest block (bytes) for a fragment
+#define EBINDEXFIRST 1024 // entries for which the index of a file has room at first, it doubles when needed
+
+typedef struct{
+  char name[100];
+  int fd;         // opened by the writer thread: -1 before, -2 when it cannot be opened
+  int direct;     // written with direct I/O
+  off_t prealloc; // bytes to reserve on disk when the file is opened
+  off_t offset;   // direct I/O: start of the last, incomplete block in the file
+  size_t ntail;   // direct I/O: bytes in the last block
+  char *tail;     // direct I/O: the last block, written again with the next batch
+  char *head;     // direct I/O: the first block, to rewrite the file header
+  uint32_t crc;   // checksum of the checksums of the events written so far (evindex.h)
+  uint64_t bytes; // bytes written so far, the position of the next event
+  char *index;    // index footer (evindex.h) of the events written so far
+  int nindex;     // events in the index
+  int maxindex;   // room in the index
+  FILEHDR fhdr;   // the final file header, written by the sealer thread
+  void *next;     // next file waiting for the sealer thread
+}EBFILE;
+
+typedef struct{
+  EBFILE *file;   // file to which the batch is written
+  size_t length;  // bytes in the batch
+  int niov;
+  struct iovec iov[EBNIOV]; // the pieces of data to write
+  size_t hdrlength;
+  char hdr[EBHDRSIZE]; // copies of the event and file headers
+  int nslot;
+  int slot[EBNIOV];    // fragments (eb_slab_alloc) in the batch, free after writing
+  int nevent;
+  int event[EBNIOV];   // piece with the header of each event, the writer fills in its checksum
+  int packed;     // the fragments are compressed, or need not be
+  int close;      // after writing: append the index, rewrite the file header (fhdr) and close the file
+  int index;      // with close: the file gets an index (not the MON files)
+  FILEHDR fhdr;
+  struct timeval first; // the first data was added
+}EBBUF;
+
+typedef struct{
+  double bytes;     // bytes written
+  int buffers;      // buffers handed to the writer
+  int maxqueue;     // most buffers waiting to be written
+  int stalls;       // number of times the builder had to wait for a free buffer
+  double stalltime; // time (s) the builder waited
+  double writetime; // time (s) spent writing
+  double maxwrite;  // slowest write of a buffer (s)
+  int sealed;       // files completed by the sealer thread
+  double sealtime;  // time (s) spent completing files
+  double maxseal;   // slowest file (s)
+  double rawbytes;  // bytes of the fragments before compression
+  double packbytes; // bytes of the fragments after compression
+}EBWSTAT;
+
+int eb_writer_start();
+EBFILE *eb_writer_open(char *name,off_t prealloc);
+void eb_put(int stream,EBFILE *file,void *data,size_t length,int slot);
+void eb_put_event(int stream,EBFILE *file,EVHDR *evhdr);
+void eb_put_close(int stream,EBFILE *file,FILEHDR *fhdr);
+void eb_writer_idle();
+void eb_writer_flush();
+void eb_writer_sync();
+void eb_writer_seal_sync();
+void eb_writer_print(FILE *fp);
+int eb_writer_packing();
+double eb_writer_ratio();
+int eb_slab_init(int mbyte);
+int eb_slab_alloc(size_t length);
+void eb_slab_free(int *frag,int nfrag);
+uint16_t *eb_slab_data(int frag);
+double eb_slab_usage();
+int eb_slab_maxfrag();
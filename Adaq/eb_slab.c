@@ -0,0 +1,200 @@
+/***
+ Event Builder fragment memory: size class slab allocator
+ Version:1.0
+ Date: 19/10/2026
+ ***/
+#include <unistd.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include "Adaq.h"
+#include "eb.h"
+
+/*
+ The memory for fragments (eb_memory MB) is divided in pages of EBPAGE bytes.
+ A page in use holds blocks of one size class; the classes go up in steps of 1, 1.5, 2, 3, 4, ... times EBMINBLOCK,
+ so at most a third of a block is unused. A page with free blocks is in the list of its class,
+ a page of which all blocks are free goes back to the free pages, and can be used for another class.
+ A fragment is known by its number: page*EBPAGEBLK+block.
+ Blocks are taken by the builder and freed by the writer thread once they are written.
+ */
+#define EBPAGEBLK (EBPAGE/EBMINBLOCK) // most blocks in a page
+#define EBNCLASS 20 // size classes, the largest holds the largest fragment (2*EVSIZE bytes)
+
+typedef struct{
+  int sizeclass;  // size class, -1 for a free page
+  int nfree;      // free blocks
+  int free;       // first free block, the next free block is stored in the block itself
+  int prev,next;  // pages of the same class with free blocks, or the free pages
+}EBPAGEINFO;
+
+char *eb_arena = NULL;
+int eb_npage = 0;
+EBPAGEINFO *eb_page = NULL;
+int eb_freepage = -1;  // first free page
+int n_freepage = 0;
+int eb_classpage[EBNCLASS]; // first page with free blocks of each class
+int eb_classsize[EBNCLASS]; // block size (bytes) of each class
+pthread_mutex_t eb_slablock = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ int eb_slab_init(int mbyte)
+
+ reserve mbyte MB for fragments (only the first time) and mark all memory free
+ */
+int eb_slab_init(int mbyte)
+{
+  int ip,ic;
+
+  if(eb_arena == NULL){
+    eb_npage = (int)(((size_t)mbyte*1024*1024)/EBPAGE);
+    if(eb_npage < 1) eb_npage = 1;
+    eb_arena = (char *)malloc((size_t)eb_npage*EBPAGE);
+    eb_page = (EBPAGEINFO *)malloc(eb_npage*sizeof(EBPAGEINFO));
+    if(eb_arena == NULL || eb_page == NULL){
+      printf("EB: Cannot reserve %d MB for the event fragments\n",mbyte);
+      return(ERROR);
+    }
+  }
+  for(ic=0;ic<EBNCLASS;ic++){
+    eb_classsize[ic] = (ic&1) ? 3*(EBMINBLOCK<<(ic/2))/2 : EBMINBLOCK<<(ic/2);
+    eb_classpage[ic] = -1;
+  }
+  for(ip=0;ip<eb_npage;ip++){
+    eb_page[ip].sizeclass = -1;
+    eb_page[ip].next = ip+1;
+    eb_page[ip].prev = ip-1;
+  }
+  eb_page[eb_npage-1].next = -1;
+  eb_freepage = 0;
+  n_freepage = eb_npage;
+  return(NORMAL);
+}
+
+/**
+ void eb_slab_unlink(int *list,int ip)
+
+ remove page ip from a list of pages
+ */
+void eb_slab_unlink(int *list,int ip)
+{
+  if(eb_page[ip].prev >= 0) eb_page[eb_page[ip].prev].next = eb_page[ip].next;
+  else *list = eb_page[ip].next;
+  if(eb_page[ip].next >= 0) eb_page[eb_page[ip].next].prev = eb_page[ip].prev;
+}
+
+/**
+ void eb_slab_link(int *list,int ip)
+
+ put page ip in front of a list of pages
+ */
+void eb_slab_link(int *list,int ip)
+{
+  eb_page[ip].prev = -1;
+  eb_page[ip].next = *list;
+  if(*list >= 0) eb_page[*list].prev = ip;
+  *list = ip;
+}
+
+/**
+ int eb_slab_alloc(size_t length)
+
+ get a block for a fragment of length bytes, returns the number of the fragment or -1 when the memory is full
+ */
+int eb_slab_alloc(size_t length)
+{
+  EBPAGEINFO *page;
+  int ic,ip,ib,nblock;
+
+  for(ic=0;ic<EBNCLASS && (size_t)eb_classsize[ic] < length;ic++);
+  if(ic == EBNCLASS) return(-1);
+  pthread_mutex_lock(&eb_slablock);
+  ip = eb_classpage[ic];
+  if(ip < 0){ // take a free page, and link its blocks
+    ip = eb_freepage;
+    if(ip < 0){
+      pthread_mutex_unlock(&eb_slablock);
+      return(-1);
+    }
+    eb_slab_unlink(&eb_freepage,ip);
+    n_freepage--;
+    page = &eb_page[ip];
+    nblock = EBPAGE/eb_classsize[ic];
+    page->sizeclass = ic;
+    page->nfree = nblock;
+    page->free = 0;
+    for(ib=0;ib<nblock;ib++)
+      *(int *)(eb_arena+(size_t)ip*EBPAGE+(size_t)ib*eb_classsize[ic]) = (ib < nblock-1) ? ib+1 : -1;
+    eb_slab_link(&eb_classpage[ic],ip);
+  }
+  page = &eb_page[ip];
+  ib = page->free;
+  page->free = *(int *)(eb_arena+(size_t)ip*EBPAGE+(size_t)ib*eb_classsize[ic]);
+  page->nfree--;
+  if(page->nfree == 0) eb_slab_unlink(&eb_classpage[ic],ip);
+  pthread_mutex_unlock(&eb_slablock);
+  return(ip*EBPAGEBLK+ib);
+}
+
+/**
+ void eb_slab_free(int *frag,int nfrag)
+
+ return the blocks of the fragments frag[0..nfrag-1]
+ */
+void eb_slab_free(int *frag,int nfrag)
+{
+  EBPAGEINFO *page;
+  int i,ip,ib,ic;
+
+  pthread_mutex_lock(&eb_slablock);
+  for(i=0;i<nfrag;i++){
+    ip = frag[i]/EBPAGEBLK;
+    ib = frag[i]%EBPAGEBLK;
+    page = &eb_page[ip];
+    ic = page->sizeclass;
+    *(int *)(eb_arena+(size_t)ip*EBPAGE+(size_t)ib*eb_classsize[ic]) = page->free;
+    page->free = ib;
+    if(page->nfree == 0) eb_slab_link(&eb_classpage[ic],ip);
+    page->nfree++;
+    if(page->nfree == EBPAGE/eb_classsize[ic]){ // the page is empty
+      eb_slab_unlink(&eb_classpage[ic],ip);
+      page->sizeclass = -1;
+      eb_slab_link(&eb_freepage,ip);
+      n_freepage++;
+    }
+  }
+  pthread_mutex_unlock(&eb_slablock);
+}
+
+/**
+ uint16_t *eb_slab_data(int frag)
+
+ address of fragment frag
+ */
+uint16_t *eb_slab_data(int frag)
+{
+  int ip = frag/EBPAGEBLK;
+
+  return((uint16_t *)(eb_arena+(size_t)ip*EBPAGE+(size_t)(frag%EBPAGEBLK)*eb_classsize[eb_page[ip].sizeclass]));
+}
+
+/**
+ double eb_slab_usage()
+
+ fraction of the pages in use
+ */
+double eb_slab_usage()
+{
+  return(1.-(double)n_freepage/eb_npage);
+}
+
+/**
+ int eb_slab_maxfrag()
+
+ the largest number of fragments that fit in the memory
+ */
+int eb_slab_maxfrag()
+{
+  return(eb_npage*EBPAGEBLK);
+}
@@ -0,0 +1,846 @@
+/***
+ Event Builder output: asynchronous writer thread
+ Version:1.0
+ Date: 19/10/2026
+ ***/
+#define _GNU_SOURCE // O_DIRECT and fallocate
+#include <unistd.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <sys/time.h>
+#include <sys/uio.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#include <linux/aio_abi.h>
+#endif
+#include "Adaq.h"
+#include "eb.h"
+#include "scope.h"
+#include "evpack.h"
+#include "evindex.h"
+#include "crc32c.h"
+
+#define EBNSTAGE 2 // direct I/O: aligned buffers, one is filled while the other is written
+#define EBSTAGESIZE (EBBUFSIZE+2*EVSIZE*sizeof(uint16_t)+2*EBALIGN) // a batch and the last block of its file
+#define EBSTAGEDATA (EBSTAGESIZE-EBALIGN) // bytes copied into a buffer, the rest is for the padding
+
+EBBUF eb_buf[EBNBUF];
+int eb_free[EBNBUF];   // buffers that can be filled
+int n_ebfree = 0;
+int eb_queue[EBNBUF];  // filled buffers, in the order they are to be written
+int eb_qread = 0;
+int n_ebqueue = 0;
+int n_ebpack = 0;      // queued buffers taken by the pack threads, from eb_qread on
+int eb_pack_size = 0;  // pack threads running
+int eb_writing = 0;    // the writer thread is busy with a buffer
+EBBUF *eb_fill[EBNOUT]; // buffer being filled for each stream
+EBWSTAT eb_wstat;
+char *eb_stage[EBNSTAGE]; // direct I/O: aligned copies of the batches
+int i_stage = 0;
+#ifdef __linux__
+aio_context_t eb_aio = 0; // direct I/O: the batches are written with Linux AIO
+struct iocb eb_iocb;
+EBFILE *eb_aiofile = NULL; // file of the write in progress, NULL when there is none
+#endif
+
+EBFILE *eb_sealfirst = NULL,*eb_seallast = NULL; // files waiting for the sealer thread
+int eb_sealing = 0;    // the sealer thread is busy with a file
+
+pthread_t eb_writer_thread;
+pthread_t eb_sealer_thread;
+pthread_t eb_pack_thread[MAXPACKTHREADS];
+pthread_mutex_t eb_wlock = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t eb_wqueued = PTHREAD_COND_INITIALIZER; // a buffer was queued or compressed
+pthread_cond_t eb_pqueued = PTHREAD_COND_INITIALIZER; // a buffer waits to be compressed
+pthread_cond_t eb_wfree = PTHREAD_COND_INITIALIZER;   // a buffer was written
+pthread_cond_t eb_squeued = PTHREAD_COND_INITIALIZER; // a file waits to be sealed
+pthread_cond_t eb_sdone = PTHREAD_COND_INITIALIZER;   // a file was sealed
+
+/**
+ double eb_since(struct timeval *t0)
+
+ seconds since t0
+ */
+double eb_since(struct timeval *t0)
+{
+  struct timeval tnow;
+  struct timezone tz;
+
+  gettimeofday(&tnow,&tz);
+  return((tnow.tv_sec-t0->tv_sec)+1.e-6*(tnow.tv_usec-t0->tv_usec));
+}
+
+/**
+ void eb_writev(int fd,struct iovec *iov,int niov)
+
+ write the pieces of a batch with writev, continuing after a partial write
+ */
+void eb_writev(int fd,struct iovec *iov,int niov)
+{
+  ssize_t n;
+
+  while(niov > 0){
+    n = writev(fd,iov,niov);
+    if(n <= 0){
+      printf("EB: Error writing data\n");
+      break;
+    }
+    while(niov > 0 && n >= (ssize_t)iov->iov_len){ // skip what is written
+      n -= iov->iov_len;
+      iov++;
+      niov--;
+    }
+    if(niov > 0){
+      iov->iov_base = (char *)iov->iov_base+n;
+      iov->iov_len -= n;
+    }
+  }
+}
+
+/**
+ void eb_file_open(EBFILE *file)
+
+ open an event file in the writer thread, so the builder does not wait for it.
+ With direct I/O the expected size of the file is reserved on disk,
+ so the file can grow without the file system searching for space.
+ */
+void eb_file_open(EBFILE *file)
+{
+  int flags = O_WRONLY|O_CREAT|O_TRUNC;
+
+#ifdef __linux__
+  if(file->direct){
+    file->fd = open(file->name,flags|O_DIRECT,0644);
+    if(file->fd < 0){
+      printf("EB: No direct I/O for %s, the page cache is used\n",file->name);
+      file->direct = 0;
+    }
+    else if(file->prealloc > 0) fallocate(file->fd,FALLOC_FL_KEEP_SIZE,0,file->prealloc);
+  }
+#endif
+  if(!file->direct) file->fd = open(file->name,flags,0644);
+  if(file->fd < 0){
+    printf("EB: Cannot open %s\n",file->name);
+    file->fd = -2;
+  }
+}
+
+/**
+ void eb_aio_wait()
+
+ direct I/O: wait for the write in progress
+ */
+void eb_aio_wait()
+{
+#ifdef __linux__
+  struct io_event ev;
+
+  if(eb_aiofile == NULL) return;
+  while(syscall(SYS_io_getevents,eb_aio,1,1,&ev,NULL) != 1){
+    if(errno != EINTR){
+      ev.res = -1;
+      break;
+    }
+  }
+  if(ev.res != (int64_t)eb_iocb.aio_nbytes) printf("EB: Error writing data to %s\n",eb_aiofile->name);
+  eb_aiofile = NULL;
+#endif
+}
+
+/**
+ void eb_aio_write(EBFILE *file,char *data,size_t length)
+
+ direct I/O: start writing length bytes (whole blocks) at the offset of the last block of the file.
+ Only one write is in progress, the next batch is copied in the meantime.
+ Without AIO the data is written immediately.
+ */
+void eb_aio_write(EBFILE *file,char *data,size_t length)
+{
+#ifdef __linux__
+  struct iocb *cb = &eb_iocb;
+
+  eb_aio_wait(); // it may write the same block
+  if(eb_aio != 0){
+    memset(&eb_iocb,0,sizeof(struct iocb));
+    eb_iocb.aio_lio_opcode = IOCB_CMD_PWRITE;
+    eb_iocb.aio_fildes = file->fd;
+    eb_iocb.aio_buf = (uint64_t)(uintptr_t)data;
+    eb_iocb.aio_nbytes = length;
+    eb_iocb.aio_offset = file->offset;
+    if(syscall(SYS_io_submit,eb_aio,1,&cb) == 1){
+      eb_aiofile = file;
+      return;
+    }
+  }
+#endif
+  if(pwrite(file->fd,data,length,file->offset) != (ssize_t)length) printf("EB: Error writing data to %s\n",file->name);
+}
+
+/**
+ void eb_write_direct(EBFILE *file,struct iovec *iov,int niov)
+
+ direct I/O: copy the last block of the file and the pieces of a batch into an aligned buffer,
+ and write it padded to whole blocks. A batch that does not fit (its last event goes beyond EBBUFSIZE)
+ is written in more parts. The last block is kept, and written again with the next batch,
+ so all data is on disk, and the memory of the fragments is free as soon as the batch is copied.
+ */
+void eb_write_direct(EBFILE *file,struct iovec *iov,int niov)
+{
+  char *stage;
+  size_t length,full;
+  int i = 0;
+
+  while(i < niov){
+    stage = eb_stage[i_stage];
+    memcpy(stage,file->tail,file->ntail);
+    length = file->ntail;
+    for(;i<niov && length+iov[i].iov_len <= EBSTAGEDATA;i++){ // a piece is at most EBBUFSIZE bytes
+      memcpy(stage+length,iov[i].iov_base,iov[i].iov_len);
+      length += iov[i].iov_len;
+    }
+    full = EBALIGN*(length/EBALIGN);
+    if(full < length) memset(stage+length,0,full+EBALIGN-length);
+    if(file->offset == 0) memcpy(file->head,stage,EBALIGN);
+    eb_aio_write(file,stage,full < length ? full+EBALIGN : full);
+    file->ntail = length-full;
+    memcpy(file->tail,stage+full,file->ntail);
+    file->offset += full;
+    i_stage = (i_stage+1)%EBNSTAGE;
+  }
+}
+
+/**
+ void eb_file_close(EBFILE *file,FILEHDR *fhdr)
+
+ rewrite the file header, flush the file to disk and close it. With direct I/O the padding
+ of the last block and the unused reserved space are removed.
+ Called by the sealer thread, all data of the file has been written
+ */
+void eb_file_close(EBFILE *file,FILEHDR *fhdr)
+{
+  if(file->fd >= 0){
+    if(file->direct){
+      if(file->offset == 0) memcpy(file->tail,fhdr,sizeof(FILEHDR)); // the file is one block
+      else{
+        memcpy(file->head,fhdr,sizeof(FILEHDR));
+        if(pwrite(file->fd,file->head,EBALIGN,0) != EBALIGN) printf("EB: Error writing the file header\n");
+      }
+      if(file->ntail > 0 || file->offset == 0){
+        memset(file->tail+file->ntail,0,EBALIGN-file->ntail);
+        if(pwrite(file->fd,file->tail,EBALIGN,file->offset) != EBALIGN) printf("EB: Error writing data to %s\n",file->name);
+      }
+      if(ftruncate(file->fd,file->offset+file->ntail) != 0) printf("EB: Cannot set the size of %s\n",file->name);
+    }
+    else if(pwrite(file->fd,fhdr,sizeof(FILEHDR),0) != sizeof(FILEHDR)) printf("EB: Error writing the file header\n");
+    if(fsync(file->fd) != 0) printf("EB: Cannot flush %s to disk\n",file->name);
+    close(file->fd);
+  }
+  free(file->index);
+  free(file->tail);
+  free(file->head);
+  free(file);
+}
+
+/**
+ void eb_index_add(EBFILE *file,EVHDR *evhdr,struct iovec *frag)
+
+ add the event with header evhdr and fragments frag[0..DU_count-1] to the index of file.
+ It starts after the bytes written so far
+ */
+void eb_index_add(EBFILE *file,EVHDR *evhdr,struct iovec *frag)
+{
+  EVINDEX *entry;
+  char *index;
+  uint16_t hw;
+  int ils,idu;
+
+  if(file->nindex == file->maxindex){
+    file->maxindex = (file->maxindex == 0) ? EBINDEXFIRST : 2*file->maxindex;
+    index = (char *)realloc(file->index,sizeof(EVINDEXHDR)+file->maxindex*sizeof(EVINDEX));
+    if(index == NULL){
+      printf("EB: No memory for the index of an event file\n");
+      file->maxindex = file->nindex;
+      return;
+    }
+    file->index = index;
+  }
+  entry = (EVINDEX *)(file->index+sizeof(EVINDEXHDR))+file->nindex;
+  memset(entry,0,sizeof(EVINDEX));
+  entry->offset = file->bytes;
+  entry->event_id = evhdr->event_id;
+  entry->t3_id = evhdr->t3_id;
+  entry->seconds = evhdr->seconds;
+  entry->nanosec = evhdr->nanosec;
+  entry->type = evhdr->type;
+  entry->DU_count = evhdr->DU_count;
+  for(ils=0;ils<(int)evhdr->DU_count;ils++){
+    hw = ((uint16_t *)frag[ils].iov_base)[EVT_HARDWARE];
+    for(idu=0;idu<tot_du && idu<32*EVINDEXMASK;idu++){
+      if(DUinfo[idu].DUid == hw){
+        entry->DU_mask[idu/32] |= 1u<<(idu%32);
+        break;
+      }
+    }
+  }
+  file->nindex++;
+}
+
+/**
+ void eb_write_index(EBFILE *file,FILEHDR *fhdr)
+
+ complete the index footer, with the checksum of the file, and append it to the file in pieces
+ of at most EBBUFSIZE bytes (the size of a direct I/O batch). Its position is noted in the file header fhdr.
+ A file of more than 4 GB has no index
+ */
+void eb_write_index(EBFILE *file,FILEHDR *fhdr)
+{
+  EVINDEXHDR *hdr;
+  struct iovec iov;
+  size_t done,nindex;
+
+  if(file->index == NULL) file->index = (char *)malloc(sizeof(EVINDEXHDR));
+  if(file->index == NULL || file->bytes > 0xffffffffULL) return;
+  nindex = sizeof(EVINDEXHDR)+file->nindex*sizeof(EVINDEX);
+  hdr = (EVINDEXHDR *)file->index;
+  hdr->length = nindex-sizeof(uint32_t);
+  hdr->magic = EVINDEXMAGIC;
+  hdr->nentry = file->nindex;
+  hdr->entrysize = sizeof(EVINDEX);
+  hdr->crc = file->crc;
+  hdr->free = 0;
+  fhdr->add1 = file->bytes;
+  fhdr->add2 = file->nindex;
+  for(done=0;done<nindex;done+=iov.iov_len){
+    iov.iov_base = file->index+done;
+    iov.iov_len = (nindex-done > EBBUFSIZE) ? EBBUFSIZE : nindex-done;
+    if(file->direct) eb_write_direct(file,&iov,1);
+    else eb_writev(file->fd,&iov,1);
+  }
+  file->bytes += nindex;
+}
+
+/**
+ void eb_seal(EBFILE *file,FILEHDR *fhdr)
+
+ hand a file of which all data is written to the sealer thread, which completes and closes it.
+ A direct I/O write of the file still in progress is finished first
+ */
+void eb_seal(EBFILE *file,FILEHDR *fhdr)
+{
+#ifdef __linux__
+  if(eb_aiofile == file) eb_aio_wait();
+#endif
+  memcpy(&file->fhdr,fhdr,sizeof(FILEHDR));
+  file->next = NULL;
+  pthread_mutex_lock(&eb_wlock);
+  if(eb_seallast != NULL) eb_seallast->next = file;
+  else eb_sealfirst = file;
+  eb_seallast = file;
+  pthread_cond_signal(&eb_squeued);
+  pthread_mutex_unlock(&eb_wlock);
+}
+
+/**
+ void *eb_sealer(void *arg)
+
+ sealer thread: complete the closed files (file header, flush to disk) in the background,
+ so neither the builder nor the writer waits for it
+ */
+void *eb_sealer(void *arg)
+{
+  EBFILE *file;
+  struct timeval tstart;
+  struct timezone tz;
+  double dt;
+
+  (void)arg; // not used
+  while(1){
+    pthread_mutex_lock(&eb_wlock);
+    while(eb_sealfirst == NULL) pthread_cond_wait(&eb_squeued,&eb_wlock);
+    file = eb_sealfirst;
+    eb_sealfirst = (EBFILE *)file->next;
+    if(eb_sealfirst == NULL) eb_seallast = NULL;
+    eb_sealing = 1;
+    pthread_mutex_unlock(&eb_wlock);
+    gettimeofday(&tstart,&tz);
+    eb_file_close(file,&file->fhdr);
+    dt = eb_since(&tstart);
+    pthread_mutex_lock(&eb_wlock);
+    eb_sealing = 0;
+    eb_wstat.sealed++;
+    eb_wstat.sealtime += dt;
+    if(dt > eb_wstat.maxseal) eb_wstat.maxseal = dt;
+    pthread_cond_broadcast(&eb_sdone);
+    pthread_mutex_unlock(&eb_wlock);
+  }
+  return(NULL);
+}
+
+/**
+ void eb_checksum(EBBUF *buf)
+
+ fill in the checksum (CRC32C) of every event in a batch, add it to the checksum of the file,
+ and add the event to the index of the file at its position.
+ An event is its header (a copy, which can be changed) followed by its DU_count fragments
+ */
+void eb_checksum(EBBUF *buf)
+{
+  EVHDR *evhdr;
+  uint32_t crc;
+  int ie,i,last,ip = 0;
+
+  for(ie=0;ie<buf->nevent;ie++){
+    i = buf->event[ie];
+    for(;ip<i;ip++) buf->file->bytes += buf->iov[ip].iov_len; // pieces before the event
+    evhdr = (EVHDR *)buf->iov[i].iov_base;
+    last = i+evhdr->DU_count;
+    evhdr->free = 0;
+    evhdr->event_free = EVCRCMAGIC;
+    crc = crc32c(0,evhdr,buf->iov[i].iov_len);
+    for(i++;i<=last && i<buf->niov;i++) crc = crc32c(crc,buf->iov[i].iov_base,buf->iov[i].iov_len);
+    evhdr->free = crc;
+    buf->file->crc = crc32c(buf->file->crc,&crc,sizeof(crc));
+    eb_index_add(buf->file,evhdr,&buf->iov[buf->event[ie]+1]);
+  }
+  for(;ip<buf->niov;ip++) buf->file->bytes += buf->iov[ip].iov_len;
+}
+
+/**
+ void eb_write_buffer(EBBUF *buf)
+
+ write a batch to its file, with writev (the data is gathered from the headers and the fragments in memory)
+ or with direct I/O; the file is opened with its first batch.
+ When requested append the index, and hand the file to the sealer thread
+ */
+void eb_write_buffer(EBBUF *buf)
+{
+  EBFILE *file = buf->file;
+
+  if(file->fd == -1) eb_file_open(file);
+  if(file->fd >= 0 && buf->niov > 0){
+    eb_checksum(buf);
+    if(file->direct) eb_write_direct(file,buf->iov,buf->niov);
+    else eb_writev(file->fd,buf->iov,buf->niov);
+  }
+  if(buf->close){
+    if(file->fd >= 0 && buf->index) eb_write_index(file,&buf->fhdr);
+    eb_seal(file,&buf->fhdr);
+  }
+}
+
+/**
+ void eb_pack_buffer(EBBUF *buf,uint16_t *out)
+
+ compress the traces of the fragments of all events in a batch (evpack.h), each through out and back into
+ its own block (which has room for the 2 words a packed fragment may need more, see eb_insert).
+ The lengths of the pieces, of the event headers and of the batch are corrected
+ */
+void eb_pack_buffer(EBBUF *buf,uint16_t *out)
+{
+  EVHDR *evhdr;
+  uint16_t *DUn;
+  double raw = 0,packed = 0;
+  int ie,i,last,length;
+
+  for(ie=0;ie<buf->nevent;ie++){
+    i = buf->event[ie];
+    evhdr = (EVHDR *)buf->iov[i].iov_base;
+    last = i+evhdr->DU_count;
+    for(i++;i<=last && i<buf->niov;i++){
+      DUn = (uint16_t *)buf->iov[i].iov_base;
+      length = ev_pack(DUn,out);
+      memcpy(DUn,out,2*length);
+      raw += buf->iov[i].iov_len;
+      packed += 2*length;
+      evhdr->length -= buf->iov[i].iov_len-2*length;
+      buf->length -= buf->iov[i].iov_len-2*length;
+      buf->iov[i].iov_len = 2*length;
+    }
+  }
+  pthread_mutex_lock(&eb_wlock);
+  eb_wstat.rawbytes += raw;
+  eb_wstat.packbytes += packed;
+  buf->packed = 1;
+  pthread_cond_broadcast(&eb_wqueued); // the writer may wait for this buffer
+  pthread_mutex_unlock(&eb_wlock);
+}
+
+/**
+ void *eb_packer(void *arg)
+
+ pack thread: take the next queued buffer that nobody compresses yet, and compress it.
+ With more threads successive buffers are compressed at the same time, the writer writes them in order.
+ arg is the buffer to compress a fragment into (EVPACK_SIZE(EVSIZE) words)
+ */
+void *eb_packer(void *arg)
+{
+  EBBUF *buf;
+  uint16_t *out = (uint16_t *)arg; // compression buffer, allocated by eb_writer_start
+
+  while(1){
+    pthread_mutex_lock(&eb_wlock);
+    while(n_ebpack == n_ebqueue) pthread_cond_wait(&eb_pqueued,&eb_wlock);
+    buf = &eb_buf[eb_queue[(eb_qread+n_ebpack)%EBNBUF]];
+    n_ebpack++;
+    pthread_mutex_unlock(&eb_wlock);
+    eb_pack_buffer(buf,out);
+  }
+  return(NULL);
+}
+
+/**
+ void *eb_writer(void *arg)
+
+ writer thread: write the queued buffers in order, once they are compressed, and return them to the builder
+ */
+void *eb_writer(void *arg)
+{
+  EBBUF *buf;
+  struct timeval tstart;
+  struct timezone tz;
+  double dt;
+
+  (void)arg; // not used
+  while(1){
+    pthread_mutex_lock(&eb_wlock);
+    while(n_ebqueue == 0 || !eb_buf[eb_queue[eb_qread]].packed){
+      pthread_mutex_unlock(&eb_wlock);
+      eb_aio_wait(); // nothing to write: finish the write in progress
+      pthread_mutex_lock(&eb_wlock);
+      if(n_ebqueue == 0 || !eb_buf[eb_queue[eb_qread]].packed) pthread_cond_wait(&eb_wqueued,&eb_wlock);
+    }
+    buf = &eb_buf[eb_queue[eb_qread]];
+    eb_writing = 1;
+    pthread_mutex_unlock(&eb_wlock);
+    gettimeofday(&tstart,&tz);
+    eb_write_buffer(buf);
+    dt = eb_since(&tstart);
+    eb_slab_free(buf->slot,buf->nslot);
+    buf->nslot = 0;
+    pthread_mutex_lock(&eb_wlock);
+    eb_qread = (eb_qread+1)%EBNBUF;
+    n_ebqueue--;
+    if(n_ebpack > 0) n_ebpack--;
+    eb_writing = 0;
+    eb_free[n_ebfree++] = buf-eb_buf;
+    eb_wstat.bytes += buf->length;
+    eb_wstat.writetime += dt;
+    if(dt > eb_wstat.maxwrite) eb_wstat.maxwrite = dt;
+    pthread_cond_signal(&eb_wfree);
+    pthread_mutex_unlock(&eb_wlock);
+  }
+  return(NULL);
+}
+
+/**
+ int eb_writer_start()
+
+ start the writer thread, the sealer thread that completes closed files,
+ and with eb_compress the eb_compress threads that compress the batches before they are written.
+ For direct I/O (eb_direct) the aligned buffers and the AIO context are made
+ */
+int eb_writer_start()
+{
+  int i;
+  uint16_t *out;
+
+  crc32c_init();
+  if(eb_direct && eb_stage[0] == NULL){
+#ifdef __linux__
+    for(i=0;i<EBNSTAGE;i++){
+      if(posix_memalign((void **)&eb_stage[i],EBALIGN,EBSTAGESIZE) != 0){
+        printf("EB: No memory for direct I/O, the page cache is used\n");
+        eb_stage[0] = NULL;
+        break;
+      }
+    }
+    if(eb_stage[0] != NULL && syscall(SYS_io_setup,1,&eb_aio) != 0){
+      printf("EB: No AIO, direct I/O is written synchronously\n");
+      eb_aio = 0;
+    }
+#else
+    printf("EB: Direct I/O is only available on Linux, the page cache is used\n");
+#endif
+  }
+
+  for(i=0;i<EBNBUF;i++){
+    eb_buf[i].nslot = 0;
+    eb_free[i] = i;
+  }
+  n_ebfree = EBNBUF;
+  for(i=0;i<EBNOUT;i++) eb_fill[i] = NULL;
+  memset(&eb_wstat,0,sizeof(EBWSTAT));
+  if(pthread_create(&eb_writer_thread,NULL,eb_writer,NULL) != 0 ||
+     pthread_create(&eb_sealer_thread,NULL,eb_sealer,NULL) != 0){
+    printf("EB: Cannot start the writer threads\n");
+    return(ERROR);
+  }
+  for(eb_pack_size=0;eb_pack_size<eb_compress;eb_pack_size++){
+    out = (uint16_t *)malloc(2*EVPACK_SIZE(EVSIZE));
+    if(out == NULL || pthread_create(&eb_pack_thread[eb_pack_size],NULL,eb_packer,out) != 0){
+      printf("EB: Cannot start compression thread %d\n",eb_pack_size+1);
+      free(out);
+      break;
+    }
+  }
+  if(eb_compress > 0 && eb_pack_size == 0){
+    printf("EB: The events are not compressed\n");
+    eb_compress = 0;
+  }
+  return(NORMAL);
+}
+
+/**
+ EBFILE *eb_writer_open(char *name,off_t prealloc)
+
+ make an event file, it is opened by the writer thread with its first batch.
+ prealloc bytes are reserved on disk when it is written with direct I/O
+ */
+EBFILE *eb_writer_open(char *name,off_t prealloc)
+{
+  EBFILE *file = (EBFILE *)malloc(sizeof(EBFILE));
+
+  strncpy(file->name,name,sizeof(file->name)-1);
+  file->name[sizeof(file->name)-1] = 0;
+  file->fd = -1;
+  file->direct = (eb_stage[0] != NULL);
+  file->prealloc = prealloc;
+  file->offset = 0;
+  file->crc = 0;
+  file->bytes = 0;
+  file->index = NULL;
+  file->nindex = 0;
+  file->maxindex = 0;
+  file->ntail = 0;
+  file->tail = NULL;
+  file->head = NULL;
+  if(file->direct && (posix_memalign((void **)&file->tail,EBALIGN,EBALIGN) != 0 ||
+                      posix_memalign((void **)&file->head,EBALIGN,EBALIGN) != 0)) file->direct = 0;
+  return(file);
+}
+
+/**
+ EBBUF *eb_getbuf(EBFILE *file)
+
+ get an empty batch for file. When all buffers are waiting to be written
+ the builder has to wait (back-pressure), which is counted
+ */
+EBBUF *eb_getbuf(EBFILE *file)
+{
+  EBBUF *buf;
+  struct timeval tstart;
+  struct timezone tz;
+
+  pthread_mutex_lock(&eb_wlock);
+  if(n_ebfree == 0){
+    eb_wstat.stalls++;
+    gettimeofday(&tstart,&tz);
+    while(n_ebfree == 0) pthread_cond_wait(&eb_wfree,&eb_wlock);
+    eb_wstat.stalltime += eb_since(&tstart);
+  }
+  buf = &eb_buf[eb_free[--n_ebfree]];
+  pthread_mutex_unlock(&eb_wlock);
+  buf->file = file;
+  buf->length = 0;
+  buf->niov = 0;
+  buf->nevent = 0;
+  buf->hdrlength = 0;
+  buf->close = 0;
+  buf->index = 0;
+  gettimeofday(&buf->first,&tz);
+  return(buf);
+}
+
+/**
+ void eb_submit(EBBUF *buf)
+
+ hand a filled buffer to the writer thread, through the pack threads when there are
+ */
+void eb_submit(EBBUF *buf)
+{
+  pthread_mutex_lock(&eb_wlock);
+  buf->packed = (eb_pack_size == 0);
+  eb_queue[(eb_qread+n_ebqueue)%EBNBUF] = buf-eb_buf;
+  n_ebqueue++;
+  if(n_ebqueue > eb_wstat.maxqueue) eb_wstat.maxqueue = n_ebqueue;
+  eb_wstat.buffers++;
+  if(buf->packed) pthread_cond_signal(&eb_wqueued);
+  else pthread_cond_signal(&eb_pqueued);
+  pthread_mutex_unlock(&eb_wlock);
+}
+
+/**
+ void eb_put(int stream,EBFILE *file,void *data,size_t length,int slot)
+
+ add data for file to the batch of a stream (0: AD, 1: TD, 2: MD, EBMON: monitoring records).
+ For a fragment (slot >= 0) only its address is kept, the fragment slot is returned
+ by the writer thread after the batch is written. Headers (slot < 0) are copied.
+ The fragments of an event stay in the batch of its header (eb_put_event).
+ */
+void eb_put(int stream,EBFILE *file,void *data,size_t length,int slot)
+{
+  EBBUF *buf = eb_fill[stream];
+
+  if(buf != NULL && (buf->niov == EBNIOV ||
+                     (slot < 0 && (buf->length >= EBBUFSIZE || buf->hdrlength+length > EBHDRSIZE)))){
+    eb_submit(buf);
+    buf = NULL;
+  }
+  if(buf == NULL) buf = eb_fill[stream] = eb_getbuf(file);
+  if(slot < 0){
+    memcpy(&buf->hdr[buf->hdrlength],data,length);
+    data = &buf->hdr[buf->hdrlength];
+    buf->hdrlength += length;
+  }else buf->slot[buf->nslot++] = slot;
+  buf->iov[buf->niov].iov_base = data;
+  buf->iov[buf->niov].iov_len = length;
+  buf->niov++;
+  buf->length += length;
+}
+
+/**
+ void eb_put_event(int stream,EBFILE *file,EVHDR *evhdr)
+
+ add the header of an event to the batch of an event stream, its fragments follow with eb_put.
+ A new batch is started when the event does not fit, so the writer has the whole event to compute its checksum
+ */
+void eb_put_event(int stream,EBFILE *file,EVHDR *evhdr)
+{
+  EBBUF *buf = eb_fill[stream];
+
+  if(buf != NULL && (buf->niov+1+evhdr->DU_count > EBNIOV || buf->length >= EBBUFSIZE ||
+                     buf->hdrlength+sizeof(EVHDR) > EBHDRSIZE)){
+    eb_submit(buf);
+    buf = NULL;
+  }
+  if(buf == NULL) buf = eb_fill[stream] = eb_getbuf(file);
+  buf->event[buf->nevent++] = buf->niov;
+  eb_put(stream,file,evhdr,sizeof(EVHDR),-1);
+}
+
+/**
+ void eb_put_close(int stream,EBFILE *file,FILEHDR *fhdr)
+
+ queue the remaining data of a stream, after which the writer appends the index of the events
+ (not for the monitoring records, EBMON), rewrites the file header and closes the file.
+ The writer notes the position of the index in add1 and add2 of the file header
+ */
+void eb_put_close(int stream,EBFILE *file,FILEHDR *fhdr)
+{
+  if(eb_fill[stream] == NULL) eb_fill[stream] = eb_getbuf(file);
+  eb_fill[stream]->close = 1;
+  eb_fill[stream]->index = (stream != EBMON);
+  memcpy(&eb_fill[stream]->fhdr,fhdr,sizeof(FILEHDR));
+  eb_submit(eb_fill[stream]);
+  eb_fill[stream] = NULL;
+}
+
+/**
+ void eb_writer_idle()
+
+ hand batches to the writer thread that have been filled for more than EBFLUSH ms,
+ so events are on disk in time and their fragments are freed at a low event rate
+ */
+void eb_writer_idle()
+{
+  int stream;
+
+  for(stream=0;stream<EBNOUT;stream++){
+    if(eb_fill[stream] != NULL && eb_fill[stream]->niov > 0 && eb_since(&eb_fill[stream]->first) > 0.001*EBFLUSH){
+      eb_submit(eb_fill[stream]);
+      eb_fill[stream] = NULL;
+    }
+  }
+}
+
+/**
+ void eb_writer_flush()
+
+ hand all batches with data to the writer thread
+ */
+void eb_writer_flush()
+{
+  int stream;
+
+  for(stream=0;stream<EBNOUT;stream++){
+    if(eb_fill[stream] != NULL && eb_fill[stream]->niov > 0){
+      eb_submit(eb_fill[stream]);
+      eb_fill[stream] = NULL;
+    }
+  }
+}
+
+/**
+ void eb_writer_sync()
+
+ hand all batches to the writer thread, and wait until they are written
+ */
+void eb_writer_sync()
+{
+  eb_writer_flush();
+  pthread_mutex_lock(&eb_wlock);
+  while(n_ebqueue > 0) pthread_cond_wait(&eb_wfree,&eb_wlock);
+  pthread_mutex_unlock(&eb_wlock);
+}
+
+/**
+ void eb_writer_seal_sync()
+
+ wait until all batches are written and all closed files are completed on disk
+ */
+void eb_writer_seal_sync()
+{
+  eb_writer_sync();
+  pthread_mutex_lock(&eb_wlock);
+  while(eb_sealfirst != NULL || eb_sealing) pthread_cond_wait(&eb_sdone,&eb_wlock);
+  pthread_mutex_unlock(&eb_wlock);
+}
+
+/**
+ void eb_writer_print(FILE *fp)
+
+ print the writer statistics, used to see whether the disk keeps up
+ */
+void eb_writer_print(FILE *fp)
+{
+  pthread_mutex_lock(&eb_wlock);
+  fprintf(fp,"Writer: %.1f MB in %d buffers (%.3f s), queued %d (max %d), slowest write %.3f s\n",
+          eb_wstat.bytes/1.e6,eb_wstat.buffers,eb_wstat.writetime,n_ebqueue,eb_wstat.maxqueue,eb_wstat.maxwrite);
+  fprintf(fp,"Writer: builder waited %d times for a buffer (%.3f s)\n",eb_wstat.stalls,eb_wstat.stalltime);
+  fprintf(fp,"Writer: %d files completed (%.3f s), slowest %.3f s\n",eb_wstat.sealed,eb_wstat.sealtime,eb_wstat.maxseal);
+  if(eb_wstat.packbytes > 0)
+    fprintf(fp,"Writer: compression %.2f, %.1f MB of fragments in %.1f MB (%d threads)\n",
+            eb_wstat.rawbytes/eb_wstat.packbytes,eb_wstat.rawbytes/1.e6,eb_wstat.packbytes/1.e6,eb_pack_size);
+  pthread_mutex_unlock(&eb_wlock);
+}
+
+/**
+ int eb_writer_packing()
+
+ the number of pack threads, fixed once eb_writer_start has run. eb_compress is re-read
+ at every DU_START, so the builder asks this whether the fragments will be packed.
+ */
+int eb_writer_packing()
+{
+  return(eb_pack_size);
+}
+
+/**
+ double eb_writer_ratio()
+
+ the size of the compressed fragments relative to their original size so far (1 without compression),
+ used by the builder to estimate the size of the files
+ */
+double eb_writer_ratio()
+{
+  double ratio = 1;
+
+  pthread_mutex_lock(&eb_wlock);
+  if(eb_wstat.rawbytes > 0) ratio = eb_wstat.packbytes/eb_wstat.rawbytes;
+  pthread_mutex_unlock(&eb_wlock);
+  return(ratio);
+}
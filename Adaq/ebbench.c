@@ -0,0 +1,302 @@
+/***
+ Event Builder output benchmark
+ Version:1.0
+ Date: 19/10/2026
+ ***/
+#include <unistd.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <math.h>
+#include <sys/time.h>
+#include <sys/stat.h>
+#define _MAINDAQ    // this program owns the DAQ parameters
+#include "Adaq.h"
+#include "amsg.h"
+#include "eb.h"
+#include "scope.h"
+
+#define NDUBENCH 20 // DUs in an event
+#define FRAGBENCH (HEADER_EVT+4*1024) // shorts in a fragment: header and 4 traces of 1024 samples
+#define NNOISE 65536 // samples of noise from which the traces are taken
+
+char *configfile = "Adaq.conf";
+extern int running;
+extern EBFILE *fpout;
+
+void eb_gett3();
+void eb_getdata();
+void eb_write_events();
+void eb_close();
+void eb_release(int first);
+
+int nevent = 2000;
+int ndu = NDUBENCH;
+int fraglength = FRAGBENCH;
+int monitor = 0; // every DU sends a monitoring message every monitor events (0: never)
+uint16_t *bench_msg = NULL; // a DU_EVENT message
+uint16_t bench_noise[NNOISE]; // 14 bit ADC samples: band limited noise around 0
+
+/**
+ void bench_make_noise()
+
+ fill bench_noise with filtered random numbers of a few ADC counts, and a pulse now and then
+ */
+void bench_make_noise()
+{
+  double x = 0,y = 0;
+  int i;
+
+  srand(1);
+  for(i=0;i<NNOISE;i++){
+    x = 0.7*x+(rand()%41-20);
+    y = 0.5*y+0.5*x;
+    if((i%5000) < 40) y += 2000*sin(0.8*i)*exp(-0.1*(i%5000));
+    bench_noise[i] = ((int)y)&0x3fff;
+  }
+}
+
+/**
+ int ad_init_param(char *file)
+
+ the parameters are set on the command line, the configuration file is not read
+ */
+int ad_init_param(char *file)
+{
+  (void)file; // not used
+  return(NORMAL);
+}
+
+/**
+ double bench_since(struct timeval *t0)
+ */
+double bench_since(struct timeval *t0)
+{
+  struct timeval tnow;
+  struct timezone tz;
+
+  gettimeofday(&tnow,&tz);
+  return((tnow.tv_sec-t0->tv_sec)+1.e-6*(tnow.tv_usec-t0->tv_usec));
+}
+
+/**
+ void bench_fragment(int ev,int du)
+
+ fill the DU_EVENT message with the fragment of a DU for event ev
+ */
+void bench_fragment(int ev,int du)
+{
+  AMSG *msg = (AMSG *)bench_msg;
+  uint16_t *frag = msg->body;
+  GPSTIME t = GPS_NS(1300000000,0)+(GPSTIME)ev*10000000+du;
+  int i,ic,ns;
+
+  msg->tag = DU_EVENT;
+  msg->length = fraglength+2;
+  frag[EVT_LENGTH] = fraglength;
+  frag[EVT_ID] = ev&0xffff;
+  frag[EVT_HARDWARE] = 5100+du;
+  *(uint32_t *)&frag[EVT_SECOND] = GPS_SEC(t);
+  *(uint32_t *)&frag[EVT_NANOSEC] = GPS_NSEC(t);
+  frag[EVT_T3FLAG] = 0;
+  frag[EVT_HDRLEN] = HEADER_EVT;
+  ns = (fraglength-HEADER_EVT)/4;
+  for(ic=1;ic<=4;ic++) frag[EVT_TOT_SAMPLES+ic] = ns;
+  for(i=HEADER_EVT;i<fraglength;i++) frag[i] = bench_noise[(i+ev*997+du*7919)%NNOISE];
+}
+
+/**
+ void bench_monitor(int ev,int du,uint16_t *mon)
+
+ fill a DU_MONITOR message of DU du, sent with event ev
+ */
+void bench_monitor(int ev,int du,uint16_t *mon)
+{
+  AMSG *msg = (AMSG *)mon;
+  float value[3];
+  uint32_t firmware = 0x00123456+du;
+  int32_t second = 1300000000+ev/100;
+  int ic;
+
+  msg->tag = DU_MONITOR;
+  msg->length = 19;
+  msg->body[0] = 5100+du;
+  memcpy(&msg->body[1],&firmware,4);
+  memcpy(&msg->body[3],&second,4);
+  for(ic=0;ic<5;ic++) msg->body[5+ic] = (ev+du+ic)%1000;
+  value[0] = 20+0.01*du;
+  value[1] = 12.5+0.001*ev;
+  value[2] = 0.1*du;
+  memcpy(&msg->body[10],value,sizeof(value));
+  msg->body[16] = ev&0xff;
+}
+
+/**
+ void bench_t3(int ev)
+
+ send the T3 of event ev (all DUs) to the event builder
+ */
+void bench_t3(int ev)
+{
+  uint16_t *t3 = &shm_t3.Ubuf[(*shm_t3.size)*(*shm_t3.next_write)];
+  T3STATION *t3stat;
+  int du;
+
+  t3[1] = 3+ndu*T3STATIONSIZE;
+  t3[2] = DU_GETEVENT;
+  t3[3] = ev&0xffff;
+  for(du=0;du<ndu;du++){
+    t3stat = (T3STATION *)&t3[4+du*T3STATIONSIZE];
+    t3stat->DU_id = 5100+du;
+  }
+  t3[0] = 2; // for the event builder only
+  *shm_t3.next_write = (*shm_t3.next_write+1)%(*shm_t3.nbuf);
+  eb_gett3();
+}
+
+/**
+ double bench_eb()
+
+ build and write all events through shm_eb and the event builder, returns the time (s) until all files are complete on disk
+ */
+double bench_eb()
+{
+  struct timeval tstart;
+  struct timezone tz;
+  uint16_t mon[19];
+  int ev,du;
+
+  gettimeofday(&tstart,&tz);
+  for(ev=0;ev<nevent;ev++){
+    for(du=0;monitor > 0 && ev%monitor == 0 && du<ndu;du++){
+      if(shm_eb.Ubuf[(*shm_eb.size)*(*shm_eb.next_write)] != 0) eb_getdata(); // make room
+      bench_monitor(ev,du,mon);
+      memcpy(&shm_eb.Ubuf[(*shm_eb.size)*(*shm_eb.next_write)+1],mon,sizeof(mon));
+      shm_eb.Ubuf[(*shm_eb.size)*(*shm_eb.next_write)] = 1;
+      *shm_eb.next_write = (*shm_eb.next_write+1)%(*shm_eb.nbuf);
+    }
+    bench_t3(ev);
+    for(du=0;du<ndu;du++){
+      if(shm_eb.Ubuf[(*shm_eb.size)*(*shm_eb.next_write)] != 0) eb_getdata(); // make room
+      bench_fragment(ev,du);
+      memcpy(&shm_eb.Ubuf[(*shm_eb.size)*(*shm_eb.next_write)+1],bench_msg,2*bench_msg[0]);
+      shm_eb.Ubuf[(*shm_eb.size)*(*shm_eb.next_write)] = 1;
+      *shm_eb.next_write = (*shm_eb.next_write+1)%(*shm_eb.nbuf);
+    }
+    eb_getdata();
+    eb_write_events();
+  }
+  if(fpout != NULL) eb_close();
+  eb_writer_seal_sync();
+  return(bench_since(&tstart));
+}
+
+/**
+ double bench_stdio(char *file)
+
+ the former output: the event header and every fragment with its own fwrite, returns the time (s)
+ */
+double bench_stdio(char *file)
+{
+  struct timeval tstart;
+  struct timezone tz;
+  EVHDR evhdr;
+  FILE *fp;
+  int ev,du;
+
+  memset(&evhdr,0,sizeof(EVHDR));
+  gettimeofday(&tstart,&tz);
+  fp = fopen(file,"w");
+  if(fp == NULL) return(0);
+  for(ev=0;ev<nevent;ev++){
+    evhdr.length = 40+2*ndu*fraglength;
+    fwrite(&evhdr,1,44,fp);
+    for(du=0;du<ndu;du++){
+      bench_fragment(ev,du);
+      fwrite(((AMSG *)bench_msg)->body,1,2*fraglength,fp);
+    }
+  }
+  fclose(fp);
+  return(bench_since(&tstart));
+}
+
+/**
+ int main(int argc, char **argv)
+
+ ebbench [-n events] [-d DUs] [-l length] [-f events] [-b mbyte] [-m mbyte] [-i] [-c nthreads] [-M events] [-s] directory
+ writes events through the event builder into directory/AD, and reports the speed in MB/s of the events before compression
+ -n number of events (2000)
+ -d DUs in an event (20)
+ -l length of a fragment in shorts (4352: header and 4 traces of 1024 samples)
+ -f events in a file (EBSIZE, default all events in one file)
+ -b MB in a file (EBMBYTE, default no limit)
+ -m memory (MB) for the fragments in the event builder (EBMEMORY, 80)
+ -i write the event files with direct I/O (EBDIRECT 1)
+ -c compress the traces with nthreads threads (EBCOMPRESS nthreads)
+ -M every DU sends a monitoring message every so many events (default none), written in directory/MON
+ -s also writes the same events with one fwrite for every header and fragment, as the former event builder
+ */
+int main(int argc,char **argv)
+{
+  int opt,isub,du;
+  int stdio = 0;
+  int maxevts = 0;
+  double dt,mbyte;
+  char fname[200];
+  char *sub[4] = {"AD","TD","MD","MON"};
+
+  while((opt = getopt(argc,argv,"n:d:l:f:b:m:ic:M:s")) != -1){
+    switch(opt){
+      case 'n': nevent = atoi(optarg); break;
+      case 'd': ndu = atoi(optarg); break;
+      case 'l': fraglength = atoi(optarg); break;
+      case 'f': maxevts = atoi(optarg); break;
+      case 'b': eb_max_mbyte = atoi(optarg); break;
+      case 'm': eb_memory = atoi(optarg); break;
+      case 'i': eb_direct = 1; break;
+      case 'c': eb_compress = atoi(optarg); break;
+      case 'M': monitor = atoi(optarg); break;
+      case 's': stdio = 1; break;
+      default:
+        printf("Usage: %s [-n events] [-d DUs] [-l length] [-f events] [-b mbyte] [-m mbyte] [-i] [-c nthreads] [-M events] [-s] directory\n",argv[0]);
+        exit(-1);
+    }
+  }
+  if(optind >= argc || ndu < 1 || ndu > MAXDU || fraglength <= HEADER_EVT || fraglength+2 >= EVSIZE ||
+     eb_compress < 0 || eb_compress > MAXPACKTHREADS){
+    printf("Usage: %s [-n events] [-d DUs] [-l length] [-f events] [-b mbyte] [-m mbyte] [-i] [-c nthreads] [-M events] [-s] directory\n",argv[0]);
+    exit(-1);
+  }
+  strncpy(eb_dir,argv[optind],79);
+  for(isub=0;isub<4;isub++){
+    sprintf(fname,"%s/%s",eb_dir,sub[isub]);
+    mkdir(fname,0755);
+  }
+  for(du=0;du<ndu;du++) DUinfo[du].DUid = 5100+du; // the DUs of the configuration, for the index of the files
+  tot_du = ndu;
+  bench_make_noise();
+  bench_msg = (uint16_t *)malloc(2*(fraglength+2));
+  if(ad_shm_create(&shm_eb,NEVBUF,EVSIZE) == ERROR ||
+     ad_shm_create(&shm_t3,NT3BUF,T3SIZE) == ERROR || bench_msg == NULL){
+    printf("Cannot create the shared memories\n");
+    exit(-1);
+  }
+  eb_max_evts = (maxevts > 0) ? maxevts : nevent+1;
+  eb_release(0);
+  if(eb_writer_start() == ERROR) exit(-1);
+  running = 1;
+  mbyte = 1.e-6*nevent*(44+2.*ndu*fraglength);
+  printf("%d events of %d DUs, %d shorts per DU: %.1f MB\n",nevent,ndu,fraglength,mbyte);
+  dt = bench_eb();
+  printf("%-20s %8.3f s: %8.1f MB/s\n","event builder",dt,mbyte/dt);
+  eb_writer_print(stdout);
+  if(stdio){
+    sprintf(fname,"%s/stdio.dat",eb_dir);
+    dt = bench_stdio(fname);
+    printf("%-20s %8.3f s: %8.1f MB/s\n","fwrite per fragment",dt,mbyte/dt);
+    unlink(fname);
+  }
+  ad_shm_delete(&shm_eb);
+  ad_shm_delete(&shm_t3);
+  return(0);
+}
@@ -0,0 +1,373 @@
+/***
+ Synthetic T2 generator: noise, RFI bursts and air showers on a configurable array
+ Version:1.0
+ Date: 19/10/2026
+ ***/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "Adaq.h"
+#include "t3.h"
+#include "t2sim.h"
+
+#define CLIGHT 0.299792458 // speed of light in m/ns
+
+int n_t2simdu = 0;
+T2SIMDU t2sim_du[MAXDU];    // the simulated array
+float t2sim_scale = 1;      // multiplies all rates
+int t2sim_duration = 10;    // seconds of data
+uint32_t t2sim_start = 1000000000; // first GPS second
+long t2sim_seed = 1;
+float t2sim_rfirate = 0;    // RFI bursts per second
+int t2sim_rfilength = 0;    // duration of a burst (ns)
+int t2sim_rfit2 = 0;        // T2s of a DU in a burst
+float t2sim_rfifrac = 0;    // fraction of the DUs seeing a burst
+float t2sim_shrate = 0;     // showers per second
+float t2sim_radius = 0;     // DUs within this distance from the shower axis (m) have a T2
+float t2sim_thetamax = 0;   // maximal zenith angle (degrees)
+float t2sim_jitter = 0;     // timing jitter (ns, rms)
+
+T2SIMSHOWER *t2sim_shower = NULL;
+int n_t2simshower = 0;
+int n_shalloc = 0;
+T2SIMHIT *t2sim_hit = NULL; // all shower T2s, ordered in time
+int n_t2simhit = 0;
+int n_hitalloc = 0;
+
+T2rec *t2sim_rec = NULL;
+int n_t2simrec = 0;
+int n_t2simalloc = 0;
+
+/**
+ int t2sim_read(char *file)
+
+ read the description of the simulation. Lines (# for comments):
+ DURATION seconds
+ START gpssecond
+ SEED seed
+ SCALE factor (multiplies all rates)
+ DU id x y noiserate flag (one line for each DU)
+ GRID nx ny spacing noiserate flag firstid (a rectangular array of DUs)
+ RFI rate length nt2 fraction (bursts of nt2 T2s in length ns, seen by a fraction of the DUs)
+ SHOWER rate radius thetamax jitter (plane wave showers, seen by all DUs within radius m from the axis)
+ */
+int t2sim_read(char *file)
+{
+  FILE *fp;
+  char line[200],key[20];
+  int id,flag,nx,ny,ix,iy;
+  float x,y,rate,spacing;
+
+  fp = fopen(file,"r");
+  if(fp == NULL) return(ERROR);
+  while(fgets(line,199,fp) == line){
+    if(line[0] == '#') continue;
+    if(sscanf(line,"%19s",key) != 1) continue;
+    if(strcmp(key,"DURATION") == 0){
+      sscanf(&line[9],"%d",&t2sim_duration);
+    }
+    if(strcmp(key,"START") == 0){
+      sscanf(&line[6],"%u",&t2sim_start);
+    }
+    if(strcmp(key,"SEED") == 0){
+      sscanf(&line[5],"%ld",&t2sim_seed);
+    }
+    if(strcmp(key,"SCALE") == 0){
+      sscanf(&line[6],"%g",&t2sim_scale);
+    }
+    if(strcmp(key,"DU") == 0){
+      if(sscanf(&line[3],"%d %g %g %g %d",&id,&x,&y,&rate,&flag) == 5 && n_t2simdu < MAXDU){
+        t2sim_du[n_t2simdu].id = id;
+        t2sim_du[n_t2simdu].x = x;
+        t2sim_du[n_t2simdu].y = y;
+        t2sim_du[n_t2simdu].rate = rate;
+        t2sim_du[n_t2simdu].flag = flag;
+        n_t2simdu++;
+      }
+    }
+    if(strcmp(key,"GRID") == 0){
+      if(sscanf(&line[5],"%d %d %g %g %d %d",&nx,&ny,&spacing,&rate,&flag,&id) == 6){
+        for(iy=0;iy<ny;iy++){
+          for(ix=0;ix<nx && n_t2simdu < MAXDU;ix++){
+            t2sim_du[n_t2simdu].id = id++;
+            t2sim_du[n_t2simdu].x = ix*spacing;
+            t2sim_du[n_t2simdu].y = iy*spacing;
+            t2sim_du[n_t2simdu].rate = rate;
+            t2sim_du[n_t2simdu].flag = flag;
+            n_t2simdu++;
+          }
+        }
+      }
+    }
+    if(strcmp(key,"RFI") == 0){
+      sscanf(&line[4],"%g %d %d %g",&t2sim_rfirate,&t2sim_rfilength,&t2sim_rfit2,&t2sim_rfifrac);
+    }
+    if(strcmp(key,"SHOWER") == 0){
+      sscanf(&line[7],"%g %g %g %g",&t2sim_shrate,&t2sim_radius,&t2sim_thetamax,&t2sim_jitter);
+    }
+  }
+  fclose(fp);
+  if(n_t2simdu == 0){
+    printf("No DUs in the simulation %s\n",file);
+    return(ERROR);
+  }
+  return(NORMAL);
+}
+
+/**
+ double t2sim_next(double t,double rate)
+
+ time (ns) of the next Poisson event after t, for a rate in Hz
+ */
+double t2sim_next(double t,double rate)
+{
+  return(t-log(1.-drand48())*GIGA/rate);
+}
+
+/**
+ double t2sim_gauss()
+
+ normal distributed random number (Box-Muller)
+ */
+double t2sim_gauss()
+{
+  return(sqrt(-2.*log(1.-drand48()))*cos(2*M_PI*drand48()));
+}
+
+/**
+ int t2sim_add(int idu,double t)
+
+ add a T2 of DU idu at t ns after the start of the simulation.
+ T2s outside the simulated time are dropped (returns 0)
+ */
+int t2sim_add(int idu,double t)
+{
+  GPSTIME time;
+
+  if(t < 0 || t >= (double)t2sim_duration*GIGA) return(0);
+  if(n_t2simrec >= n_t2simalloc){
+    n_t2simalloc = 2*n_t2simalloc+10000;
+    t2sim_rec = (T2rec *)realloc(t2sim_rec,n_t2simalloc*sizeof(T2rec));
+    if(t2sim_rec == NULL) return(0);
+  }
+  time = GPS_NS(t2sim_start,0)+(GPSTIME)t;
+  t2sim_rec[n_t2simrec].du = t2sim_du[idu].id;
+  t2sim_rec[n_t2simrec].sec = GPS_SEC(time);
+  t2sim_rec[n_t2simrec].nsec = GPS_NSEC(time);
+  t2sim_rec[n_t2simrec].trigflag = t2sim_du[idu].flag;
+  n_t2simrec++;
+  return(1);
+}
+
+/**
+ void t2sim_make_shower(double t0)
+
+ a plane wave shower with its core at a random position in the array at time t0 (ns).
+ The zenith angle is drawn from a flux proportional to cos(theta)sin(theta)
+ */
+void t2sim_make_shower(double t0)
+{
+  static float xmin,xmax,ymin,ymax;
+  T2SIMSHOWER *sh;
+  double nx,ny,dx,dy,along,dist2,st;
+  int idu;
+
+  if(n_t2simshower == 0){
+    xmin = xmax = t2sim_du[0].x;
+    ymin = ymax = t2sim_du[0].y;
+    for(idu=1;idu<n_t2simdu;idu++){
+      if(t2sim_du[idu].x < xmin) xmin = t2sim_du[idu].x;
+      if(t2sim_du[idu].x > xmax) xmax = t2sim_du[idu].x;
+      if(t2sim_du[idu].y < ymin) ymin = t2sim_du[idu].y;
+      if(t2sim_du[idu].y > ymax) ymax = t2sim_du[idu].y;
+    }
+  }
+  if(n_t2simshower >= n_shalloc){
+    n_shalloc = 2*n_shalloc+1000;
+    t2sim_shower = (T2SIMSHOWER *)realloc(t2sim_shower,n_shalloc*sizeof(T2SIMSHOWER));
+    if(t2sim_shower == NULL) return;
+  }
+  sh = &t2sim_shower[n_t2simshower];
+  sh->t0 = GPS_NS(t2sim_start,0)+(GPSTIME)t0;
+  sh->x = xmin+(xmax-xmin)*drand48();
+  sh->y = ymin+(ymax-ymin)*drand48();
+  st = sin(t2sim_thetamax*M_PI/180.);
+  sh->theta = asin(st*sqrt(drand48()));
+  sh->phi = 2*M_PI*drand48();
+  sh->nhit = 0;
+  sh->found = 0;
+  nx = sin(sh->theta)*cos(sh->phi); // towards the source
+  ny = sin(sh->theta)*sin(sh->phi);
+  for(idu=0;idu<n_t2simdu;idu++){
+    dx = t2sim_du[idu].x-sh->x;
+    dy = t2sim_du[idu].y-sh->y;
+    along = dx*nx+dy*ny;
+    dist2 = dx*dx+dy*dy-along*along;
+    if(dist2 > t2sim_radius*t2sim_radius) continue;
+    if(t2sim_add(idu,t0-along/CLIGHT+t2sim_jitter*t2sim_gauss()) == 0) continue;
+    if(n_t2simhit >= n_hitalloc){
+      n_hitalloc = 2*n_hitalloc+10000;
+      t2sim_hit = (T2SIMHIT *)realloc(t2sim_hit,n_hitalloc*sizeof(T2SIMHIT));
+      if(t2sim_hit == NULL) return;
+    }
+    t2sim_hit[n_t2simhit].time = GPS_NS(t2sim_rec[n_t2simrec-1].sec,t2sim_rec[n_t2simrec-1].nsec);
+    t2sim_hit[n_t2simhit].du = t2sim_du[idu].id;
+    t2sim_hit[n_t2simhit].shower = n_t2simshower;
+    n_t2simhit++;
+    sh->nhit++;
+  }
+  n_t2simshower++;
+}
+
+int t2sim_hitcompare(const void *a, const void *b)
+{
+  T2SIMHIT *h1 = (T2SIMHIT *)a;
+  T2SIMHIT *h2 = (T2SIMHIT *)b;
+
+  if(h1->time != h2->time) return(h1->time < h2->time ? -1 : 1);
+  return(h1->du-h2->du);
+}
+
+/**
+ int t2sim_generate(T2rec **rec,int *n)
+
+ generate the T2s of all DUs: Poisson noise, RFI bursts and showers, with all rates multiplied by t2sim_scale.
+ The T2s are returned unordered in rec (n T2s)
+ */
+int t2sim_generate(T2rec **rec,int *n)
+{
+  int idu,i;
+  double t,tb,tend = (double)t2sim_duration*GIGA;
+
+  srand48(t2sim_seed);
+  n_t2simrec = 0;
+  for(idu=0;idu<n_t2simdu;idu++){
+    if(t2sim_du[idu].rate*t2sim_scale <= 0) continue;
+    for(t=t2sim_next(0,t2sim_du[idu].rate*t2sim_scale);t<tend;t=t2sim_next(t,t2sim_du[idu].rate*t2sim_scale))
+      t2sim_add(idu,t);
+  }
+  if(t2sim_rfirate*t2sim_scale > 0){
+    for(tb=t2sim_next(0,t2sim_rfirate*t2sim_scale);tb<tend;tb=t2sim_next(tb,t2sim_rfirate*t2sim_scale)){
+      for(idu=0;idu<n_t2simdu;idu++){
+        if(drand48() >= t2sim_rfifrac) continue;
+        for(i=0;i<t2sim_rfit2;i++) t2sim_add(idu,tb+t2sim_rfilength*drand48());
+      }
+    }
+  }
+  if(t2sim_shrate*t2sim_scale > 0){
+    for(t=t2sim_next(0,t2sim_shrate*t2sim_scale);t<tend;t=t2sim_next(t,t2sim_shrate*t2sim_scale))
+      t2sim_make_shower(t);
+  }
+  if(t2sim_rec == NULL) return(ERROR);
+  qsort(t2sim_hit,n_t2simhit,sizeof(T2SIMHIT),t2sim_hitcompare);
+  *rec = t2sim_rec;
+  *n = n_t2simrec;
+  printf("Simulated %d DUs for %d s: %d T2s, %d showers with %d T2s\n",n_t2simdu,t2sim_duration,
+         n_t2simrec,n_t2simshower,n_t2simhit);
+  return(NORMAL);
+}
+
+/**
+ void t2sim_positions()
+
+ use the simulated array for the station list and positions of the T3 maker
+ */
+void t2sim_positions()
+{
+  int i;
+
+  for(i=0;i<MAXDU;i++){
+    if(i<n_t2simdu){
+      statlist[i] = t2sim_du[i].id;
+      posx[i] = t2sim_du[i].x;
+      posy[i] = t2sim_du[i].y;
+    }else statlist[i] = -1;
+  }
+}
+
+/**
+ void t2sim_reset()
+
+ forget which showers were found
+ */
+void t2sim_reset()
+{
+  int i;
+
+  for(i=0;i<n_t2simshower;i++) t2sim_shower[i].found = 0;
+}
+
+/**
+ void t2sim_t3(uint16_t *list,uint32_t gpssec)
+
+ find the shower T2s in a T3 list. The T3 only holds the lowest 8 bits of the second,
+ gpssec is a recent second (less than 256 s after the T2s) to complete it.
+ Every T2 in the T3 is matched to a shower T2 of the same DU in the same 64 ns
+ */
+void t2sim_t3(uint16_t *list,uint32_t gpssec)
+{
+  T3STATION *t3stat;
+  GPSTIME t;
+  uint32_t sec;
+  int i,lo,hi,mid,nst;
+  int shower[MAXDU],count[MAXDU],ns = 0;
+
+  for(i=3;i<list[0];i+=T3STATIONSIZE){
+    t3stat = (T3STATION *)(&list[i]);
+    sec = gpssec-((gpssec-t3stat->sec)&0xff);
+    t = GPS_NS(sec,((t3stat->NS1<<16)+(t3stat->NS2<<8)+t3stat->NS3)<<6);
+    lo = 0;
+    hi = n_t2simhit;
+    while(lo < hi){ // first hit at or after t
+      mid = (lo+hi)/2;
+      if(t2sim_hit[mid].time < t) lo = mid+1;
+      else hi = mid;
+    }
+    for(;lo<n_t2simhit && t2sim_hit[lo].time < t+64;lo++){
+      if(t2sim_hit[lo].du != t3stat->DU_id) continue;
+      for(nst=0;nst<ns;nst++)
+        if(shower[nst] == t2sim_hit[lo].shower) break;
+      if(nst == ns){
+        if(ns >= MAXDU) break;
+        shower[ns] = t2sim_hit[lo].shower;
+        count[ns++] = 0;
+      }
+      count[nst]++;
+      break;
+    }
+  }
+  for(nst=0;nst<ns;nst++){
+    if(count[nst] > t2sim_shower[shower[nst]].found) t2sim_shower[shower[nst]].found = count[nst];
+  }
+}
+
+/**
+ void t2sim_report(char *prefix)
+
+ print the trigger efficiency as a function of the number of DUs hit by a shower,
+ and the fraction of the shower T2s that were in the T3
+ */
+void t2sim_report(char *prefix)
+{
+  int i,ib,nsh[NSIMBIN],ntrig[NSIMBIN];
+  long nhit = 0,nfound = 0;
+
+  for(ib=0;ib<NSIMBIN;ib++) nsh[ib] = ntrig[ib] = 0;
+  for(i=0;i<n_t2simshower;i++){
+    ib = t2sim_shower[i].nhit;
+    if(ib >= NSIMBIN) ib = NSIMBIN-1;
+    nsh[ib]++;
+    if(t2sim_shower[i].found > 0){
+      ntrig[ib]++;
+      nhit += t2sim_shower[i].nhit;
+      nfound += t2sim_shower[i].found;
+    }
+  }
+  printf("%-14s showers %d, DUs hit: efficiency\n",prefix,n_t2simshower);
+  for(ib=1;ib<NSIMBIN;ib++){
+    if(nsh[ib] == 0) continue;
+    printf("%-14s %2d%s %6d: %6.1f%%\n",prefix,ib,(ib == NSIMBIN-1)?"+":" ",nsh[ib],100.*ntrig[ib]/nsh[ib]);
+  }
+  if(nhit > 0) printf("%-14s shower T2s in the T3 of triggered showers: %.1f%%\n",prefix,100.*nfound/nhit);
+}
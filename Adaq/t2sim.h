@@ -0,0 +1,47 @@
+/***
+ Synthetic T2 generator definitions
+ Version:1.0
+ Date: 19/10/2026
+ ***/
+#include "amsg.h"
+
+#define NSIMBIN 11 // efficiency bins in number of DUs hit, the last one is for NSIMBIN-1 and more
+
+typedef struct{
+  uint32_t du;
+  uint32_t sec;
+  uint32_t nsec;
+  uint32_t trigflag;
+}T2rec; // one T2, as read from a text file or generated
+
+typedef struct{
+  int id;          // DU number
+  float x,y;       // position (m)
+  float rate;      // noise rate (Hz)
+  int flag;        // trigger flag of the T2s
+}T2SIMDU;
+
+typedef struct{
+  GPSTIME t0;      // time of the shower front at the core
+  float x,y;       // core position (m)
+  float theta,phi; // arrival direction (rad)
+  int nhit;        // number of DUs with a T2
+  int found;       // largest number of these T2s in one T3
+}T2SIMSHOWER;
+
+typedef struct{
+  GPSTIME time;    // time of the T2
+  int du;          // DU number
+  int shower;      // index of the shower
+}T2SIMHIT;
+
+extern int n_t2simdu;
+extern T2SIMDU t2sim_du[MAXDU];
+extern float t2sim_scale;
+
+int t2sim_read(char *file);
+int t2sim_generate(T2rec **rec,int *n);
+void t2sim_positions();
+void t2sim_reset();
+void t2sim_t3(uint16_t *list,uint32_t gpssec);
+void t2sim_report(char *prefix);
@@ -12,42 +12,395 @@
 #include <stdlib.h>
 #include <sys/time.h>
 #include <math.h>
+#include <pthread.h>
 #include "Adaq.h"
 #include "amsg.h"
+#include "t3.h"
 
-#define MAXRATE 1000
-#define MAXSEC 12 // has to be above 10 to avoid missing 10sec triggers!
-#define NEVT (MAXSEC*MAXDU*MAXRATE)
-#define GIGA    1000000000
-#define MEGA    1000000
-#define T3DELAY (2*MEGA)
-#define NNEAR 0 // station needs 2 nearest neghbours to fire (ie 3 DUs  in 1 km2)
-#define TNEAR 4900 //maximum time for nearest neighbours
+#define T3SLICEMIN 256 // minimal number of T2s in a time slice handled by a separate thread
+#define NSCAN 8 // T2 times compared in one vector operation
+
+typedef int64_t v8l __attribute__((vector_size(NSCAN*sizeof(int64_t))));
+
+typedef struct{
+  int DUid;
+  GPSTIME time;            // time of the newest T2 received from this DU
+  struct timeval arrival;  // arrival of the latest T2 message of this DU
+}T3WATERMARK;
+
+typedef struct{
+  GPSTIME time;
+  int DUid;
+}T2KEY;
 
 typedef struct{
-  int stat;
-  int unit;
-  unsigned int insertsec;
-  int insertmusec;
-  unsigned int sec;
-  unsigned int nsec;
-  int trigflag;
-  int used;
-}T2evts;
-
-T2evts t2evts[NEVT]; //storage of data directly from the shared memory. This is the local sorted storage!
+  int DUid;
+  double tokens;           // T3 requests the DU can still receive
+  struct timeval refill;   // last time tokens were added
+  int suppressed[NT3CLASS]; // requests not sent to this DU
+}T3BUCKET;
+
+//storage of data directly from the shared memory. This is the local sorted storage!
+GPSTIME t2time[NEVT];    // newest first
+uint64_t t2insert[NEVT]; // arrival in us
+uint16_t t2stat[NEVT];   // DU id
+uint16_t t2unit[NEVT];   // index in statlist
+int32_t t2off[NEVT];     // timing offset subtracted on arrival, added again in the T3 request
+uint16_t t2flag[NEVT];   // trigflag, T2USED, T2DONE
+T2evts t2new[NT2NEW];    // new T2s, not yet in the store
+int t2nnew = 0;
+T2KEY t2hash[1<<T2HASHBITS]; // T2s received in the last MAXSEC seconds
+GPSTIME t2hashtime = 0;      // newest T2 in the hash set, see t3_dupl
+int t3dupl = 0;              // number of duplicate T2s removed
+int t3acc[NACC][NACC];       // coincidences in the shifted windows for t3accstat and t3acctime
+int t3accstat[NACC],t3acctime[NACC];
+GPSTIME t3accfirst,t3acclast; // first and last T2 with counted shifted windows
+GPSTIME t3first,t3last;      // first and last T2 of a T3
+int t3count = 0;             // T3s between t3first and t3last
+int t2nwin[NEVT]; // number of T2s in the coincidence window starting at each T2
 uint16_t t3list[3+3*MAXDU]; //identifiers of the T3 event
 uint16_t t3event=0;
+int t3veto=0; // number of T3 candidates vetoed by the plane wave fit
+T3WATERMARK t3wm[MAXDU]; // event time reached by each DU
+int n_t3wm = 0;
+int t3stalled = 0; // number of DUs that did not send T2s within t3_wait
+T3BUCKET t3bucket[MAXDU]; // T3 request budget of each DU
+int n_t3bucket = 0;
+int t3suppressed[NT3CLASS]; // requests not sent because of the budget, per trigger class
+int t3budgetdrop = 0; // physics T3s not sent because fewer than t3_stat DUs had budget left
 
 int32_t t2write = 0;
 uint32_t last_read_sec = 0;
 
 extern int idebug;
 
+T3ALGO *t3algo = &t3algos[0]; // the trigger algorithm in use
+void (*t3_clock)(struct timeval *tp) = NULL; // replaces the system clock when replaying data
+void (*t3_publish)(uint16_t *list,struct timeval *tfirst) = NULL; // called for each T3 written to shm_t3
+FILE *fp_t2rec = NULL; // recording of all T2 messages
+
+typedef struct{
+  int lo; // newest T2 (lowest index) in the slice
+  int hi; // oldest T2 (highest index) in the slice
+}T3SLICE;
+
+pthread_t t3_pool[MAXT3THREADS];
+T3SLICE t3_slice[MAXT3THREADS];
+pthread_mutex_t t3_pool_lock = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t t3_pool_start = PTHREAD_COND_INITIALIZER;
+pthread_cond_t t3_pool_done = PTHREAD_COND_INITIALIZER;
+int t3_pool_size = 0;   // number of worker threads running
+int t3_pool_gen = 0;    // incremented for each new set of slices
+int t3_pool_busy = 0;   // number of workers still scanning their slice
+
 //database
 int statlist[MAXDU]; //conversion from DU number to regular index to be used
 float posx[MAXDU],posy[MAXDU]; // stations X and Y positions, to be read at initialization!
+double t3offset[MAXDU]; // timing offset (ns) of each station, subtracted from its T2 times
+int t3learned = 0; // number of T3s used to correct the offsets
 int ctimes[MAXDU][MAXDU];
+/**
+ void t3_now(struct timeval *tp)
+ 
+ time used to decide if T2s are old enough; the system clock unless data is replayed
+ */
+void t3_now(struct timeval *tp)
+{
+  struct timezone tz;
+  
+  if(t3_clock != NULL) t3_clock(tp);
+  else gettimeofday(tp,&tz);
+}
+
+/**
+ void t3_record(AMSG *msg,struct timeval *tp)
+ 
+ append a message from the T2 shared memory with its arrival time to the T2 recording
+ */
+void t3_record(AMSG *msg,struct timeval *tp)
+{
+  T2RECMSG rec;
+  
+  rec.sec = tp->tv_sec;
+  rec.usec = tp->tv_usec;
+  fwrite(&rec,1,sizeof(T2RECMSG),fp_t2rec);
+  fwrite(msg,1,2*msg->length,fp_t2rec);
+}
+
+/**
+ void t3_open_record(char *file)
+ 
+ open the T2 recording; a restarted T3 maker continues an existing file
+ */
+void t3_open_record(char *file)
+{
+  T2RECHDR hdr;
+  
+  fp_t2rec = fopen(file,"a");
+  if(fp_t2rec == NULL){
+    printf("T3: Cannot open T2 recording %s\n",file);
+    return;
+  }
+  if(ftell(fp_t2rec) == 0){
+    hdr.magic = T2REC_MAGIC;
+    hdr.version = T2REC_VERSION;
+    fwrite(&hdr,1,sizeof(T2RECHDR),fp_t2rec);
+  }
+}
+
+/**
+ void t3_set_watermark(int DUid,GPSTIME time,struct timeval *tp)
+ 
+ a DU sends its T2s in time order: it has advanced up to time
+ */
+void t3_set_watermark(int DUid,GPSTIME time,struct timeval *tp)
+{
+  int i;
+  
+  for(i=0;i<n_t3wm;i++){
+    if(t3wm[i].DUid == DUid) break;
+  }
+  if(i == n_t3wm){
+    if(n_t3wm >= MAXDU) return;
+    n_t3wm++;
+    t3wm[i].DUid = DUid;
+    t3wm[i].time = 0;
+  }
+  if(time > t3wm[i].time) t3wm[i].time = time;
+  t3wm[i].arrival = *tp;
+}
+
+/**
+ void t3_watermark_init()
+ 
+ forget the DUs and the T2s that have not been merged yet
+ */
+void t3_watermark_init()
+{
+  n_t3wm = 0;
+  t3stalled = 0;
+  t2nnew = 0;
+}
+
+/**
+ int t3_watermark(struct timeval *tp,GPSTIME *time)
+ 
+ the event time all DUs have advanced past. DUs without T2s for more than t3_wait ms are stalled and ignored.
+ returns 0 when there is no DU that is not stalled
+ */
+int t3_watermark(struct timeval *tp,GPSTIME *time)
+{
+  int i,nactive = 0;
+  
+  t3stalled = 0;
+  for(i=0;i<n_t3wm;i++){
+    if((tp->tv_sec-t3wm[i].arrival.tv_sec)*1000+(tp->tv_usec-t3wm[i].arrival.tv_usec)/1000 > t3_wait){
+      t3stalled++;
+      continue;
+    }
+    if(nactive == 0 || t3wm[i].time < *time) *time = t3wm[i].time;
+    nactive++;
+  }
+  return(nactive);
+}
+
+/**
+ void t3_budget_init()
+ 
+ all DUs start with a full budget
+ */
+void t3_budget_init()
+{
+  int i;
+  
+  n_t3bucket = 0;
+  for(i=0;i<NT3CLASS;i++) t3suppressed[i] = 0;
+  t3budgetdrop = 0;
+}
+
+/**
+ int t3_take_budget(int DUid,int class,struct timeval *tp,int take)
+ 
+ token bucket of T3 requests for each DU: t3_budget tokens are added per second, up to t3_burst.
+ A physics T3 request takes a token as long as there is one. Random and 10 second requests
+ leave a reserve (T3RESERVE_RANDOM, T3RESERVE_MINBIAS of t3_burst) for physics.
+ With take 0 the budget is only checked: no token is taken and nothing is counted.
+ returns 1 when the request can be sent, 0 when it is suppressed
+ */
+int t3_take_budget(int DUid,int class,struct timeval *tp,int take)
+{
+  int i;
+  double dt,reserve;
+  
+  if(t3_budget <= 0) return(1);
+  for(i=0;i<n_t3bucket;i++){
+    if(t3bucket[i].DUid == DUid) break;
+  }
+  if(i == n_t3bucket){
+    if(n_t3bucket >= MAXDU) return(1);
+    n_t3bucket++;
+    t3bucket[i].DUid = DUid;
+    t3bucket[i].tokens = t3_burst;
+    t3bucket[i].refill = *tp;
+    memset(t3bucket[i].suppressed,0,sizeof(t3bucket[i].suppressed));
+  }
+  dt = (tp->tv_sec-t3bucket[i].refill.tv_sec)+1.e-6*(tp->tv_usec-t3bucket[i].refill.tv_usec);
+  if(dt > 0){
+    t3bucket[i].tokens += dt*t3_budget;
+    if(t3bucket[i].tokens > t3_burst) t3bucket[i].tokens = t3_burst;
+    t3bucket[i].refill = *tp;
+  }
+  reserve = 0;
+  if(class == T3RANDOM) reserve = T3RESERVE_RANDOM*t3_burst;
+  if(class == T3MINBIAS) reserve = T3RESERVE_MINBIAS*t3_burst;
+  if(take == 0) return(t3bucket[i].tokens >= 1+reserve);
+  if(t3bucket[i].tokens < 1+reserve){
+    t3bucket[i].suppressed[class]++;
+    t3suppressed[class]++;
+    return(0);
+  }
+  t3bucket[i].tokens -= 1;
+  return(1);
+}
+
+/**
+ void t3_dupl_init()
+ 
+ empty the T2 hash set
+ */
+void t3_dupl_init()
+{
+  memset(t2hash,0,sizeof(t2hash));
+  t2hashtime = 0;
+  t3dupl = 0;
+}
+
+/**
+ int t3_dupl(int DUid,GPSTIME time)
+ 
+ check if a T2 was received before, using a hash set with open addressing.
+ Entries more than MAXSEC seconds older than the newest T2 are free, so the set does not need cleaning.
+ A T2 more than T2HASHAHEAD seconds ahead of the newest T2 so far does not count as the newest
+ (a single wrong time would otherwise free all entries), t3_maket3 moves the time on with the watermark.
+ When there is no free entry within T2HASHPROBE places, the oldest of these is replaced.
+ returns 1 for a duplicate, 0 for a new T2 (which is added to the set)
+ */
+int t3_dupl(int DUid,GPSTIME time)
+{
+  uint64_t h;
+  GPSTIME told;
+  int i,ifree = -1,iold = -1;
+  T2KEY *k;
+  
+  if(time > t2hashtime && (t2hashtime == 0 || time-t2hashtime < (uint64_t)T2HASHAHEAD*GIGA)) t2hashtime = time;
+  told = (t2hashtime > (uint64_t)MAXSEC*GIGA) ? t2hashtime-(uint64_t)MAXSEC*GIGA : 0;
+  h = (time^((uint64_t)DUid*0x9e3779b97f4a7c15ULL))*0xff51afd7ed558ccdULL;
+  h >>= 64-T2HASHBITS;
+  for(i=0;i<T2HASHPROBE;i++){
+    k = &t2hash[(h+i)&((1<<T2HASHBITS)-1)];
+    if(k->time == 0 || k->time < told){
+      if(ifree < 0) ifree = (h+i)&((1<<T2HASHBITS)-1);
+      if(k->time == 0) break; // never used: the T2 can not be further on
+      continue;
+    }
+    if(k->time == time && k->DUid == DUid){
+      t3dupl++;
+      return(1);
+    }
+    if(iold < 0 || k->time < t2hash[iold].time) iold = (h+i)&((1<<T2HASHBITS)-1);
+  }
+  if(ifree < 0) ifree = iold;
+  t2hash[ifree].time = time;
+  t2hash[ifree].DUid = DUid;
+  return(0);
+}
+
+/**
+ void t3_shadow_init()
+ 
+ accidental T3 rates are estimated for T3STAT-1..T3STAT+1 and T3TIME/2..2*T3TIME
+ */
+void t3_shadow_init()
+{
+  int is,it;
+  
+  for(is=0;is<NACC;is++){
+    t3accstat[is] = t3_stat-1+is;
+    t3acctime[is] = (t3_time<<is)/2;
+    for(it=0;it<NACC;it++) t3acc[is][it] = 0;
+  }
+  if(t3accstat[0] < 2) for(is=0;is<NACC;is++) t3accstat[is] = 2+is;
+  t3accfirst = t3acclast = 0;
+  t3first = t3last = 0;
+  t3count = 0;
+}
+
+/**
+ int t3_nlater(GPSTIME time,int ind)
+ 
+ number of T2s newer than T2 ind (index below ind) with a time of at least time
+ */
+int t3_nlater(GPSTIME time,int ind)
+{
+  int lo = 0,hi = ind,mid;
+  
+  while(lo < hi){ // T2s lo..hi-1 are undecided
+    mid = (lo+hi)/2;
+    if(t2time[mid] >= time) lo = mid+1;
+    else hi = mid;
+  }
+  return(lo);
+}
+
+/**
+ void t3_count_shadow(int ind)
+ 
+ count the T2s in windows shifted by k*T3SHIFT (k=1..t3_shadow) after T2 ind.
+ T2s in a shifted window are not related to T2 ind by a shower,
+ so the shifted coincidences estimate the accidental T3 rate (of the multiplicity trigger).
+ */
+void t3_count_shadow(int ind)
+{
+  int k,is,it,n,nfirst;
+  GPSTIME tstart;
+  
+  t2flag[ind] |= T2SHADOW;
+  if(t3accfirst == 0) t3accfirst = t2time[ind];
+  if(t2time[ind] > t3acclast) t3acclast = t2time[ind];
+  for(k=1;k<=t3_shadow;k++){
+    tstart = t2time[ind]+(GPSTIME)k*T3SHIFT;
+    nfirst = t3_nlater(tstart,ind);
+    for(it=0;it<NACC;it++){
+      n = 1+nfirst-t3_nlater(tstart+t3acctime[it]+1,ind);
+      for(is=0;is<NACC;is++){
+        if(n >= t3accstat[is]) t3acc[is][it]++;
+      }
+    }
+  }
+}
+
+/**
+ double t3_shadow_rate(int is,int it)
+ 
+ accidental T3 rate (Hz) for T3STAT t3accstat[is] and T3TIME t3acctime[it]
+ */
+double t3_shadow_rate(int is,int it)
+{
+  if(t3_shadow == 0 || t3acclast <= t3accfirst) return(0);
+  return(GIGA*(double)t3acc[is][it]/t3_shadow/(t3acclast-t3accfirst));
+}
+
+/**
+ double t3_rate()
+ 
+ rate (Hz) of physics T3s (not random or 10 second T3s)
+ */
+double t3_rate()
+{
+  if(t3last <= t3first) return(0);
+  return(GIGA*(double)t3count/(t3last-t3first));
+}
+
 /**
  int t3_compare(const void *a, const void *b)
  
@@ -58,55 +411,109 @@ int t3_compare(const void *a, const void *b)
   T2evts *t1,*t2;
   t1 = (T2evts *)a;
   t2 = (T2evts *)b;
-  if(t1->sec < t2->sec) return(1);
-  if(t1->sec == t2->sec){
-    if(t1->nsec < t2->nsec) return(1);
-    else if(t2->nsec < t1->nsec) return(-1);
-    else return(0);
+  if(t1->time < t2->time) return(1);
+  if(t1->time > t2->time) return(-1);
+  return(0);
+}
+
+/**
+ void t3_merge(struct timeval *tp)
+ 
+ merge the new T2s into the T2 store.
+ The store is compacted first (removing used T2s and T2s at least MAXSEC seconds old),
+ then the sorted new T2s are merged in from the end; the store itself is never sorted again.
+ */
+void t3_merge(struct timeval *tp)
+{
+  int i,j,k;
+  uint64_t now,told;
+  
+  if(t2nnew == 0) return;
+  now = (uint64_t)tp->tv_sec*MEGA+tp->tv_usec;
+  told = (uint64_t)MAXSEC*MEGA;
+  for(i=0,k=0;i<t2write;i++){ //clear old or used data
+    if((t2flag[i]&T2USED) || now-t2insert[i] > told) continue;
+    if(k != i){
+      t2time[k] = t2time[i];
+      t2insert[k] = t2insert[i];
+      t2stat[k] = t2stat[i];
+      t2unit[k] = t2unit[i];
+      t2off[k] = t2off[i];
+      t2flag[k] = t2flag[i];
+    }
+    k++;
+  }
+  t2write = k;
+  qsort(t2new,t2nnew,sizeof(T2evts),t3_compare);
+  if(t2write+t2nnew > NEVT) {
+    printf("T3: Full buffer %d\n",t2write+t2nnew);
+    t2nnew = NEVT-t2write;
+  }
+  i = t2write-1;
+  j = t2nnew-1;
+  for(k=t2write+t2nnew-1;j>=0;k--){ // oldest first; new T2s go after stored T2s with the same time
+    if(i >= 0 && t2time[i] < t2new[j].time){
+      t2time[k] = t2time[i];
+      t2insert[k] = t2insert[i];
+      t2stat[k] = t2stat[i];
+      t2unit[k] = t2unit[i];
+      t2off[k] = t2off[i];
+      t2flag[k] = t2flag[i];
+      i--;
+    } else{
+      t2time[k] = t2new[j].time;
+      t2insert[k] = t2new[j].insert;
+      t2stat[k] = t2new[j].stat;
+      t2unit[k] = t2new[j].unit;
+      t2off[k] = t2new[j].off;
+      t2flag[k] = t2new[j].trigflag;
+      j--;
+    }
   }
-  return(-1);
+  t2write += t2nnew;
+  t2nnew = 0;
 }
 /**
  void t3_gett2()
  get data from the t2-shared memory
  interpret the T2 buffer (see documentation)
- write the buffer in the T2evts array
+ collect the new T2s, skipping T2s that were received before
  determine if we need to upgrade trigger automatically to T3
- reverse-sort the T2evts array
- remove old data from the array (at least MAXSEC seconds old)
+ merge the new T2s into the reverse-sorted T2 store (removing used data and data at least MAXSEC seconds old)
  */
 void t3_gett2()
 {
   AMSG *msg;
   T2BODY *t2b;
   T2SSEC *t2ss;
+  T2evts *t2;
   uint32_t sec,stat;
   uint32_t prev_nsec,nsec;
   int32_t isub,nsub;
-  int32_t ind;
+  int32_t ind,unit,off;
+  GPSTIME time;
   int gotdata=0;
   static int irandom=0;
   struct timeval tp;
-  struct timezone tz;
   
-  gettimeofday(&tp,&tz);
+  t3_now(&tp);
   if(idebug) printf("Get T2 %d %ld\n",t2write,tp.tv_sec);
   while(shm_t2.Ubuf[(*shm_t2.size)*(*shm_t2.next_read)] == 1){ // loop over the input
     msg = (AMSG *)(&(shm_t2.Ubuf[(*shm_t2.size)*(*shm_t2.next_read)+1]));
+    if(fp_t2rec != NULL) t3_record(msg,&tp);
     if(msg->tag == DU_T2){    // work on T2 messages only
       t2b = (T2BODY *)msg->body;
       stat = t2b->DU_id; // the indices of my array start at 0, stations at 1
       sec = T0(t2b->t0);  // obtain the seconds
-      /**if(sec>0x80000000) {
-        shm_t2.Ubuf[(*shm_t2.size)*(*shm_t2.next_read)] = 0;
-        *shm_t2.next_read = (*shm_t2.next_read) + 1;
-        if( *shm_t2.next_read >= *shm_t2.nbuf) *shm_t2.next_read = 0;
-        continue;
-      }**/
       if(sec != last_read_sec) last_read_sec = sec;
-      if((sec>(t2evts[0].sec+100))&&t2write != 0) {
+      if(t2write != 0 && sec>GPS_SEC(t2time[0])+(uint32_t)100) {
         printf("T3: Error in timing, large jump; LS=%d\n",stat);
       }
+      unit = 0;
+      for(ind=0;ind<MAXDU;ind++) {
+        if((int)stat == statlist[ind]) unit = ind;
+      }
+      off = t3_offset(stat,unit);
       prev_nsec = 0;      // needed to check if we loop over into next second
       nsub = (msg->length-5)/2;  // number of subseconds in this T2
       if(idebug)
@@ -116,75 +523,38 @@ void t3_gett2()
         nsec = T2NSEC(t2ss)+(((t2ss->ADC)&0xf)<<2); //lower bits removed (not according to specs, we have 28 bits?)
         if(nsec < prev_nsec) sec++;
         prev_nsec = nsec;
-        if(t2write> 0){
-          if(sec == t2evts[t2write-1].sec &&
-             nsec == t2evts[t2write-1].nsec &&
-             stat == t2evts[t2write-1].stat 
-             )  continue;
-        }
-        t2evts[t2write].insertsec = tp.tv_sec;
-        t2evts[t2write].insertmusec = tp.tv_usec;
-        t2evts[t2write].sec = sec; // save data into array
-        t2evts[t2write].nsec = nsec;
-        t2evts[t2write].trigflag = ((t2ss->ADC>>4)&0xf);
+        time = GPS_NS(sec,nsec);
+        if(t3_dupl(stat,time)) continue;
+        t2 = &t2new[t2nnew];
+        t2->insert = (uint64_t)tp.tv_sec*MEGA+tp.tv_usec;
+        t2->time = time-off; // save data into array, corrected for the timing offset
+        t2->off = off;
+        t2->trigflag = ((t2ss->ADC>>4)&0xf);
         irandom++; // for random writing of data
         if(t3_rand>0){
           if(irandom >=t3_rand){
             irandom = 0;
-            //printf("T3: A random event %d.%09d ",t2evts[t2write].sec,t2evts[t2write].nsec);
-            t2evts[t2write].trigflag = (t2evts[t2write].trigflag|8);
-            //printf("%x\n",t2evts[t2write].trigflag);
+            t2->trigflag = (t2->trigflag|8);
           }
         }
-        t2evts[t2write].stat = stat;
-        for(ind=0;ind<MAXDU;ind++) {
-          if(stat == statlist[ind]) t2evts[t2write].unit = ind;
-        }
-        t2evts[t2write].used = 0;
-        t2write+= 1;
+        t2->stat = stat;
+        t2->unit = unit;
+        if(t3algo->ingest != NULL) t3algo->ingest(t2);
+        t2nnew+= 1;
         gotdata = 1;
-        if(t2write >=NEVT) {
-          printf("T3: Full buffer %d\n",t2write);
-          t2write = NEVT-1;
-          break;
-        }
+        if(t2nnew >=NT2NEW) t3_merge(&tp);
       }
+      t3_set_watermark(stat,GPS_NS(sec,prev_nsec)-off,&tp); // without T2s the DU is still at second t0
     }
-    //printf("After loop, t2write = %d\n",t2write);
     shm_t2.Ubuf[(*shm_t2.size)*(*shm_t2.next_read)] = 0;
     *shm_t2.next_read = (*shm_t2.next_read) + 1;
     if( *shm_t2.next_read >= *shm_t2.nbuf) *shm_t2.next_read = 0;
   }
+  if(fp_t2rec != NULL) fflush(fp_t2rec);
   if(gotdata == 0) return;
+  t3_merge(&tp);
   if(idebug)
     printf("T3: T2write = %d\n",t2write);
-  for(ind=0;ind<t2write;ind++){ //clear old or used data
-    if(((tp.tv_sec-t2evts[ind].insertsec)>MAXSEC) ||
-       (t2evts[ind].used == 1)){
-      t2evts[ind].insertsec = 0;
-      t2evts[ind].sec = 0;
-    }
-    /**if((t2evts[ind].sec>t2evts[t2write-1].sec) &&(t2evts[ind].sec-t2evts[t2write-1].sec)>MAXSEC){
-      //if(idebug)
-	printf("T3: Cleanup1 %u %u %d\n",t2evts[ind].sec,t2evts[t2write-1].sec,ind);
-      t2evts[ind].insertsec = 0; //get rid of GPS issues
-      t2evts[ind].sec = 0; //get rid of GPS issues
-      }**/
-  }
-  qsort(t2evts,t2write,sizeof(T2evts),t3_compare);
-  // remove old data
-  ind = t2write-1;
-  sec = t2evts[0].insertsec-MAXSEC;//t2evts[0] == newest!
-  if(idebug)
-    printf("Timetest %d %d %d %d\n",
-	 sec,t2evts[0].insertsec,t2evts[ind].insertsec,ind);
-  while(sec > t2evts[ind].insertsec &&ind>0) {
-    ind--; //real cleanup!
-  }
-  //if(sec >t2evts[1].insertsec )
-    t2write = ind+1;
-  //else t2write = ind;
-  //printf("t2write =  %d\n",t2write);
 }
 
 
@@ -200,86 +570,291 @@ int t3_check_t3list()
   return(1);
 }
 
+/**
+ int t3_tdif(int i,int ind)
+ 
+ time difference in ns between T2 i and the older T2 ind (GIGA when more than a second apart)
+ */
+int t3_tdif(int i,int ind)
+{
+  uint64_t dt = t2time[i]-t2time[ind];
+  
+  if(dt > GIGA) return(GIGA);
+  return((int)dt);
+}
+
+/**
+ int t3_window(int ind)
+ 
+ count the T2s (including T2 ind itself) that are within t3_time after T2 ind.
+ Short windows are searched T2 by T2. As the store is sorted, a dense window
+ (noise bursts) is searched by skipping blocks of NSCAN T2s whose newest T2 is still
+ within the window; the T2s of the final block are compared in one vector operation.
+ Only reads the T2 array, so it can be called for different T2s in parallel.
+ */
+int t3_window(int ind)
+{
+  v8l t,tmax;
+  GPSTIME last = t2time[ind]+t3_time;
+  int i = ind,k,n;
+  
+  for(k=0;k<NSCAN;k++,i--){ // most windows hold a few T2s
+    if(i == 0 || t2time[i-1] > last) return(ind-i+1);
+  }
+  while(i >= NSCAN && t2time[i-NSCAN] <= last) i -= NSCAN;
+  if(i < NSCAN){
+    while(i > 0 && t2time[i-1] <= last) i--;
+    return(ind-i+1);
+  }
+  tmax = (v8l){0}+(int64_t)last;
+  memcpy(&t,&t2time[i-NSCAN],sizeof(v8l)); // T2s i-NSCAN .. i-1
+  t = (t <= tmax); // -1 for T2s within the window
+  for(n=0,k=0;k<NSCAN;k++) n -= t[k];
+  return(ind-i+n+1);
+}
+
+/**
+ void t3_scan_slice(T3SLICE *slice)
+ 
+ run the scan of the trigger algorithm for all T2s in a time slice.
+ The windows of the newest T2s in the slice extend into the next slice (the overlap),
+ so coincidences straddling a slice boundary are found by the slice containing the oldest T2.
+ */
+void t3_scan_slice(T3SLICE *slice)
+{
+  int ind;
+  
+  for(ind=slice->hi;ind>=slice->lo;ind--){
+    if(t2flag[ind]&T2DONE) continue; // decided before
+    t2nwin[ind] = t3algo->scan(ind);
+  }
+}
+
+/**
+ void *t3_pool_worker(void *arg)
+ 
+ worker thread: wait for a new set of slices, scan its own slice and report back
+ */
+void *t3_pool_worker(void *arg)
+{
+  int iw = (int)(long)arg;
+  int gen = 0;
+  
+  while(1){
+    pthread_mutex_lock(&t3_pool_lock);
+    while(t3_pool_gen == gen) pthread_cond_wait(&t3_pool_start,&t3_pool_lock);
+    gen = t3_pool_gen;
+    pthread_mutex_unlock(&t3_pool_lock);
+    t3_scan_slice(&t3_slice[iw]);
+    pthread_mutex_lock(&t3_pool_lock);
+    t3_pool_busy--;
+    if(t3_pool_busy == 0) pthread_cond_signal(&t3_pool_done);
+    pthread_mutex_unlock(&t3_pool_lock);
+  }
+  return(NULL);
+}
+
+/**
+ void t3_scan(int lo,int hi)
+ 
+ run the scan of the trigger algorithm for T2s lo..hi.
+ The range is split into time-ordered slices of equal size, one for each thread.
+ Slice 0 is handled by the calling thread.
+ */
+void t3_scan(int lo,int hi)
+{
+  int nslice,islice,nper;
+  
+  nslice = (hi-lo+1)/T3SLICEMIN;
+  if(nslice > t3_pool_size+1) nslice = t3_pool_size+1;
+  if(nslice <= 1){
+    t3_slice[0].lo = lo;
+    t3_slice[0].hi = hi;
+    t3_scan_slice(&t3_slice[0]);
+    return;
+  }
+  nper = (hi-lo+1)/nslice;
+  for(islice=0;islice<nslice;islice++){
+    t3_slice[islice].lo = lo+islice*nper;
+    t3_slice[islice].hi = lo+(islice+1)*nper-1;
+  }
+  t3_slice[nslice-1].hi = hi;
+  for(islice=nslice;islice<=t3_pool_size;islice++){ // idle workers get an empty slice
+    t3_slice[islice].lo = 0;
+    t3_slice[islice].hi = -1;
+  }
+  pthread_mutex_lock(&t3_pool_lock);
+  t3_pool_busy = t3_pool_size;
+  t3_pool_gen++;
+  pthread_cond_broadcast(&t3_pool_start);
+  pthread_mutex_unlock(&t3_pool_lock);
+  t3_scan_slice(&t3_slice[0]);
+  pthread_mutex_lock(&t3_pool_lock);
+  while(t3_pool_busy > 0) pthread_cond_wait(&t3_pool_done,&t3_pool_lock);
+  pthread_mutex_unlock(&t3_pool_lock);
+}
+
+/**
+ int t3_offset(int stat,int unit)
+ 
+ timing offset (rounded to ns) of station stat with index unit; 0 for unknown stations
+ */
+int t3_offset(int stat,int unit)
+{
+  if(statlist[unit] != stat) return(0);
+  return((int)floor(t3offset[unit]+0.5));
+}
+
+/**
+ int t3_read_offsets(char *file)
+ 
+ read the timing offsets, lines with "DUid offset" (in ns)
+ */
+int t3_read_offsets(char *file)
+{
+  FILE *fp;
+  char line[200];
+  int id,i,noff = 0;
+  double off;
+  
+  fp = fopen(file,"r");
+  if(fp == NULL) return(ERROR);
+  while(fgets(line,199,fp) == line){
+    if(line[0] == '#') continue;
+    if(sscanf(line,"%d %lg",&id,&off) != 2) continue;
+    for(i=0;i<MAXDU;i++){
+      if(statlist[i] == id) break;
+    }
+    if(i == MAXDU){
+      printf("T3: Timing offset for unknown DU %d\n",id);
+      continue;
+    }
+    t3offset[i] = off;
+    noff++;
+  }
+  fclose(fp);
+  return(noff);
+}
+
+/**
+ void t3_write_offsets(char *file)
+ 
+ write the (learned) timing offsets, in the format read by t3_read_offsets
+ */
+void t3_write_offsets(char *file)
+{
+  FILE *fp;
+  int i;
+  
+  fp = fopen(file,"w");
+  if(fp == NULL) return;
+  fprintf(fp,"# DUid offset(ns), from %d T3s\n",t3learned);
+  for(i=0;i<MAXDU;i++){
+    if(statlist[i] >= 0) fprintf(fp,"%d %.1f\n",statlist[i],t3offset[i]);
+  }
+  fclose(fp);
+}
+
+/**
+ void t3_learn_offsets(int *eventindex,int evsize,double *res)
+ 
+ move the timing offset of each station in a T3 by t3_learn times its plane front residual.
+ A station appearing more than once in the T3 is corrected once, with its mean residual
+ */
+void t3_learn_offsets(int *eventindex,int evsize,double *res)
+{
+  int i,j,n,unit;
+  double sum;
+  
+  for(i=0;i<evsize;i++){
+    unit = t2unit[eventindex[i]];
+    for(j=0;j<i;j++) if(t2unit[eventindex[j]] == unit) break;
+    if(j < i) continue; // corrected at its first T2
+    for(sum=0,n=0,j=i;j<evsize;j++){
+      if(t2unit[eventindex[j]] != unit) continue;
+      sum += res[j];
+      n++;
+    }
+    t3offset[unit] += t3_learn*sum/n;
+  }
+  t3learned++;
+}
+
 /**
  void t3_maket3()
  
  Loop over the sorted t2 array
- Make sure the event is at least 1.5 seconds old
- Check if there are several entries for which the time difference is less than TCOINC between then
+ Make sure the coincidence window has been passed by all DUs (watermark),
+ or that the event is at least T3DELAY old (stalled DUs)
+ Determine (in parallel) for each T2 the figure of merit of the trigger algorithm
+ Loop over the T2s in time order; skip T2s that are already part of a T3,
+ or that were offered before with a complete window (T2DONE)
+ Let the trigger algorithm decide which T2s form a T3
+ Veto T3s that are not compatible with a plane shower front (T3PLANE, T2s can be used again)
+ Correct the timing offsets of the DUs with the plane front residuals (when learning)
+ Only request data from DUs that have T3 budget left (physics T3s first),
+ a physics T3 for which fewer than t3_stat DUs have budget left is not sent at all
  Check if the event is a T3 or Minbias or random
  Write data to T3 shared memory, to be submitted to the DU's
  */
 void t3_maket3()
 {
-  int ind,ip,i;
-  int tdif,insertdif;
-  int isten,israndom,nstat;
-  int usedstat[MAXDU];
-  int is1,is2;
+  int ind,ip,i,nbudget;
+  int isten,israndom,class,plane;
+  double res[MAXDU];
   int ntry;
-  int nscint,nradio,nwait;
+  int ilast,ihi,span,nwm;
+  GPSTIME wtime;
+  uint64_t now,first;
   T3STATION *t3stat;
-  int evsize,evnear;
+  int evsize;
   int eventindex[MAXDU];
-  struct timeval tp;
-  struct timezone tz;
+  struct timeval tp,tfirst;
   
-  gettimeofday(&tp,&tz);
+  t3_now(&tp);
+  now = (uint64_t)tp.tv_sec*MEGA+tp.tv_usec;
 
   if(idebug)
     printf("Entering make t3 %d\n",t2write);
-  for(ind=(t2write-1);ind>=0;ind--){
-    // 1st ensure that event is old enough, not likely for new data to appear
-    insertdif = tp.tv_sec-t2evts[ind].insertsec;
-    if(insertdif < 2 ){ //2 or more is clearly ok!
-      insertdif = MEGA*(insertdif) + (tp.tv_usec-t2evts[ind].insertmusec);
-    } else insertdif = T3DELAY+1;
-    if(insertdif< T3DELAY) break;
+  // 1st ensure that no new data can appear in the coincidence window
+  nwm = t3_watermark(&tp,&wtime);
+  if(nwm > 0 && wtime > t2hashtime) t2hashtime = wtime; // all DUs are past wtime
+  span = (t3_time>TCOINC)?t3_time:TCOINC;
+  for(i=0;i<16;i++) if(t3classwin[i] > span) span = t3classwin[i]; // trigger classes (set by t3_class_init)
+  if(t3_shadow > 0) // shifted windows are counted in the same pass
+    span = t3_shadow*T3SHIFT+((2*t3_time > span) ? 2*t3_time : span);
+  for(ilast=t2write;ilast>0;ilast--){
+    ind = ilast-1;
+    if(nwm > 0 && wtime > t2time[ind]+span) continue;
+    if(now < t2insert[ind]+T3DELAY) break;
+  }
+  for(ihi=t2write-1;ihi>=ilast;ihi--) if((t2flag[ihi]&T2DONE) == 0) break; // skip the T2s decided before
+  if(ilast > ihi) return;
+  t3_scan(ilast,ihi);
+  for(ind=ihi;ind>=ilast;ind--){
+    if(t2flag[ind]&T2DONE) continue;
+    if(t3_shadow > 0 && (t2flag[ind]&T2SHADOW) == 0) t3_count_shadow(ind);
+    if(nwm > 0 && wtime > t2time[ind]+span) t2flag[ind] |= T2DONE; // last time it is offered
     // if event is used, do not use it again
-    if(t2evts[ind].used ==1) continue;
-    //check if there are any coincidences
-    eventindex[0] = ind;
-    evsize = 1;
-    evnear = 0;
-    if(t2evts[ind].trigflag&0x4) isten = 1;
+    if(t2flag[ind]&T2USED) continue;
+    if(t2flag[ind]&0x4) isten = 1;
     else isten = 0;
-    if(t2evts[ind].trigflag&0x8) israndom = 1;
+    if(t2flag[ind]&0x8) israndom = 1;
     else israndom = 0;
-    if(isten == 1) printf("A 10 sec trigger %u\n",t2evts[ind].sec);
-    //if(israndom == 1) printf("A Random trigger %u\n",t2evts[ind].sec);
-    for(i=ind-1;i>=0;i--){
-      if(t2evts[i].sec-t2evts[ind].sec > 1) tdif = TCOINC+1;
-      else if(t2evts[i].sec-t2evts[ind].sec == 1){
-        tdif = GIGA+t2evts[i].nsec-t2evts[ind].nsec;
-      }else{
-        tdif = t2evts[i].nsec-t2evts[ind].nsec;
-      }
-      /*if(tdif <= ctimes[t2evts[i].unit][t2evts[ind].unit]) { // later when we have a field
-        if ((isten && (t2evts[i].trigflag&0x4)) || (isten==0 &&(t2evts[i].trigflag&0x4))==0){
-          eventindex[evsize] = i;
-          evsize++;
-          if(evsize>=MAXDU) {
-            printf("Too many DUs in an event, loosing data %d %d %d (%d %d) %d %d\n",isten,evsize,MAXDU,tdif,ctimes[t2evts[i].unit][t2evts[ind].unit],i,ind);
-            evsize = MAXDU-1;
-          }
-          if((ctimes[t2evts[i].unit][t2evts[ind].unit]<=TNEAR)
-             &&(t2evts[i].unit != t2evts[ind].unit)) evnear++;
-        }
-      } else if(tdif>TCOINC) break;*/
-      if(tdif<=t3_time) {
-	eventindex[evsize] = i;
-	evsize++;
-	if(evsize>=MAXDU) {
-	  printf("Too many DUs in an event, loosing data %d %d %d (%d %d) %d %d\n",isten,evsize,MAXDU,tdif,ctimes[t2evts[i].unit][t2evts[ind].unit],i,ind);
-	  evsize = MAXDU-1;
-	}
+    if(isten == 1) printf("A 10 sec trigger %u\n",GPS_SEC(t2time[ind]));
+    //if(israndom == 1) printf("A Random trigger %u\n",GPS_SEC(t2time[ind]));
+    //check if there are any coincidences
+    evsize = t3algo->emit(ind,eventindex);
+    if(evsize > 0 && (t3_plane > 0 || t3_learn > 0) && isten == 0 && israndom == 0){
+      plane = t3_planewave(eventindex,evsize,res);
+      if(plane == 0){
+        t3veto++;
+        continue;
       }
-      else break;
+      if(plane == 2 && evsize > 3 && t3_learn > 0) t3_learn_offsets(eventindex,evsize,res);
     }
-    // trigger condition is easy
-    //if((evsize>=NTRIG &&evnear>=NNEAR) || isten == 1 || israndom == 1) {
-    if(evsize>=t3_stat || isten == 1 || israndom == 1) {
-      if(isten == 1) printf("Found a T10 with %d stations T=%u\n",evsize,t2evts[ind].sec);
+    if(evsize > 0) {
+      if(isten == 1) printf("Found a T10 with %d stations T=%u\n",evsize,GPS_SEC(t2time[ind]));
       //start creating the list to send
       t3list[0] = 3; // length before adding a station
       if(isten == 1) t3list[1] = DU_GET_MINBIAS_EVENT;
@@ -287,14 +862,32 @@ void t3_maket3()
       else t3list[1] = DU_GETEVENT; // requesting an event
       t3list[2] = t3event; // event number
       ip = 3;
+      first = now;
+      if(isten == 1) class = T3MINBIAS;
+      else if(israndom == 1) class = T3RANDOM;
+      else class = T3PHYSICS;
+      if(class == T3PHYSICS && t3_budget > 0){
+        for(nbudget=0,i=0;i<evsize;i++) nbudget += t3_take_budget(t2stat[eventindex[i]],class,&tp,0);
+        if(nbudget < evsize && nbudget < t3_stat){ // no partial readout below the trigger condition
+          for(i=0;i<evsize;i++) t2flag[eventindex[i]] |= T2USED;
+          t3suppressed[class] += evsize;
+          t3budgetdrop++;
+          continue;
+        }
+      }
       for(i=0;i<evsize;i++){
-        t2evts[eventindex[i]].used = 1;
+        t2flag[eventindex[i]] |= T2USED;
+        if(t3_take_budget(t2stat[eventindex[i]],class,&tp,1) == 0) continue;
+        if(t2insert[eventindex[i]] < first) first = t2insert[eventindex[i]]; // earliest arrival of a T2 in this T3
         t3stat = (T3STATION *)(&(t3list[ip]));
-        T3STATFILL(t3stat,t2evts[eventindex[i]].stat,t2evts[eventindex[i]].sec,
-                   ((t2evts[eventindex[i]].nsec)>>6)); //filling the station info
+        T3STATFILL_GPS(t3stat,t2stat[eventindex[i]],t2time[eventindex[i]]+
+                       t2off[eventindex[i]]); //filling the station info, DU time (the offset may have been learned since)
         ip+=3;
         t3list[0]+=3;
       }
+      if(t3list[0] == 3) continue; // no DU has budget left
+      tfirst.tv_sec = first/MEGA;
+      tfirst.tv_usec = first%MEGA;
       // move the event to shared memory to be sent
       ntry = 0;
       while(shm_t3.Ubuf[(*shm_t3.size)*(*shm_t3.next_write)] != 0 &&ntry<10) {//danger! infinite loop
@@ -305,28 +898,111 @@ void t3_maket3()
         printf("T3: No buffer, loosing data\n");
       }else{
         memcpy((void *)&(shm_t3.Ubuf[(*shm_t3.size)*(*shm_t3.next_write)+1]),(void *)t3list,2*t3list[0]);
+        if(shm_lat.Ubuf != NULL){
+          if(*shm_t3.next_write < NT3BUF){
+            T3LATENCY->published[*shm_t3.next_write][0] = tp.tv_sec;
+            T3LATENCY->published[*shm_t3.next_write][1] = tp.tv_usec;
+          }
+          ad_hist_add(&T3LATENCY->t2_t3,now-first);
+        }
         shm_t3.Ubuf[(*shm_t3.size)*(*shm_t3.next_write)] = 3; // to be read by du and eb, thus will be 3 (=1+2)!!
         *shm_t3.next_write = *shm_t3.next_write + 1;
         if(*shm_t3.next_write >= *shm_t3.nbuf) *shm_t3.next_write = 0;
+        if(t3_publish != NULL) t3_publish(t3list,&tfirst);
       }
       t3event++;
+      if(class == T3PHYSICS){
+        if(t3first == 0) t3first = t2time[ind];
+        t3last = t2time[ind];
+        t3count++;
+      }
     }
   }
 }
 
+/**
+ int t3_select_algo(char *name)
+ 
+ select the trigger algorithm by name and initialize it.
+ Unknown names select the multiplicity trigger and return ERROR
+ */
+int t3_select_algo(char *name)
+{
+  int i;
+  
+  t3algo = &t3algos[0];
+  for(i=0;t3algos[i].name != NULL;i++){
+    if(strcmp(t3algos[i].name,name) == 0) t3algo = &t3algos[i];
+  }
+  if(t3algo->init != NULL) t3algo->init();
+  if(strcmp(t3algo->name,name) != 0){
+    printf("T3: Unknown trigger algorithm %s, using %s\n",name,t3algo->name);
+    return(ERROR);
+  }
+  return(NORMAL);
+}
+
+/**
+ int t3_read_positions(char *file)
+ 
+ read the station positions, lines with "DUid x y" (in m)
+ The order in the file defines the unit (index) of each station
+ */
+int t3_read_positions(char *file)
+{
+  FILE *fp;
+  char line[200];
+  int id,nstat = 0;
+  float x,y;
+  
+  fp = fopen(file,"r");
+  if(fp == NULL) return(ERROR);
+  while(fgets(line,199,fp) == line && nstat<MAXDU){
+    if(line[0] == '#') continue;
+    if(sscanf(line,"%d %g %g",&id,&x,&y) != 3) continue;
+    statlist[nstat] = id;
+    posx[nstat] = x;
+    posy[nstat] = y;
+    nstat++;
+  }
+  fclose(fp);
+  return(nstat);
+}
+
 void t3_initialize()
 {
-  int i,j;
+  int i,nstat;
   int Narray = sqrt(MAXDU);
 
   for(i=0;i<MAXDU;i++){
     statlist[i] = 5100+i; //for now all hardcoded dummies
     posx[i] = 1000*(i%Narray);
     posy[i] = 1000*(i/Narray);
-    for(j=0;j<=i;j++){
-      ctimes[i][j] = 100+(int)(GIGA*
-        sqrt((posx[i]-posx[j])*(posx[i]-posx[j])+(posy[i]-posy[j])*(posy[i]-posy[j]))/3E8);
-       ctimes[j][i] = ctimes[i][j];
+  }
+  if(t3_posfile[0] != 0){
+    if((nstat = t3_read_positions(t3_posfile)) == ERROR)
+      printf("T3: Cannot read station positions from %s\n",t3_posfile);
+    else{
+      printf("T3: Read %d station positions\n",nstat);
+      for(i=nstat;i<MAXDU;i++) statlist[i] = -1;
+    }
+  }
+  for(i=0;i<MAXDU;i++) t3offset[i] = 0;
+  if(t3_offfile[0] != 0){
+    if((nstat = t3_read_offsets(t3_offfile)) == ERROR)
+      printf("T3: Cannot read timing offsets from %s\n",t3_offfile);
+    else printf("T3: Read %d timing offsets\n",nstat);
+  }
+  t3_select_algo(t3_algo);
+  t3_watermark_init();
+  t3_budget_init();
+  t3_dupl_init();
+  t3_shadow_init();
+  if(t3_recfile[0] != 0) t3_open_record(t3_recfile);
+  for(t3_pool_size=0;t3_pool_size<t3_threads-1;t3_pool_size++){
+    if(pthread_create(&t3_pool[t3_pool_size+1],NULL,t3_pool_worker,(void *)(long)(t3_pool_size+1)) != 0){
+      printf("T3: Cannot start search thread %d\n",t3_pool_size+1);
+      break;
     }
   }
 }
@@ -338,10 +1014,13 @@ void t3_initialize()
  */
 void t3_main()
 {
-  char fname[100];
+  char fname[100],offname[100];
   FILE *fp_log;
+  int nlearned = 0;
+  int i;
   
   sprintf(fname,"%s/t3",LOG_FOLDER);
+  sprintf(offname,"%s/t3offsets",LOG_FOLDER);
   fp_log = fopen(fname,"w");
   t3_initialize();
   while(1) {
@@ -351,6 +1030,29 @@ void t3_main()
     if(shm_t3.Ubuf[(*shm_t3.size)*(*shm_t3.next_write)] == 0 )
       t3_maket3();
     fprintf(fp_log,"T3s created: %6d\n",t3event);
+    fprintf(fp_log,"T3s vetoed: %6d\n",t3veto);
+    fprintf(fp_log,"Stalled DUs: %6d\n",t3stalled);
+    fprintf(fp_log,"Duplicate T2s: %6d\n",t3dupl);
+    fprintf(fp_log,"Suppressed requests: %6d physics %6d random %6d minbias\n",
+            t3suppressed[T3PHYSICS],t3suppressed[T3RANDOM],t3suppressed[T3MINBIAS]);
+    fprintf(fp_log,"T3s without budget: %6d\n",t3budgetdrop);
+    ad_hist_print(fp_log,"Latency T2-T3",&T3LATENCY->t2_t3);
+    ad_hist_print(fp_log,"Latency T3-DU",&T3LATENCY->t3_du);
+    if(t3_learn > 0) fprintf(fp_log,"Offsets learned from: %6d T3s\n",t3learned);
+    if(strcmp(t3algo->name,"classes") == 0){
+      for(i=0;i<n_t3class;i++) fprintf(fp_log,"T3 class %-10s: %6d\n",t3_class[i].name,t3classcount[i]);
+    }
+    if(t3_shadow > 0){
+      fprintf(fp_log,"T3 rate (Hz): %8.2f accidental %8.2f\n",t3_rate(),t3_shadow_rate(1,1));
+      fprintf(fp_log,"Accidental T3 rate (Hz) for T3TIME %6d %6d %6d\n",t3acctime[0],t3acctime[1],t3acctime[2]);
+      for(i=0;i<NACC;i++)
+        fprintf(fp_log,"                        T3STAT %2d %8.2f %8.2f %8.2f\n",t3accstat[i],
+                t3_shadow_rate(i,0),t3_shadow_rate(i,1),t3_shadow_rate(i,2));
+    }
+    if(t3learned >= nlearned+100){ // learned offsets, to be used with T3OFFSET
+      t3_write_offsets(offname);
+      nlearned = t3learned;
+    }
     usleep(1000);
   }
   fclose(fp_log);
@@ -0,0 +1,115 @@
+/***
+ T3 Maker definitions
+ Version:1.0
+ Date: 19/10/2026
+ ***/
+#include <sys/time.h>
+#include "amsg.h"
+
+#define MAXRATE 1000
+#define MAXSEC 12 // has to be above 10 to avoid missing 10sec triggers!
+#define NEVT (MAXSEC*MAXDU*MAXRATE)
+#define GIGA    GPS_GIGA
+#define MEGA    1000000
+#define T3DELAY (2*MEGA)
+#define NNEAR 0 // station needs 2 nearest neghbours to fire (ie 3 DUs  in 1 km2)
+#define TNEAR 4900 //maximum time for nearest neighbours
+#define T3PHYSICS 0 // trigger classes, in order of priority
+#define T3RANDOM 1
+#define T3MINBIAS 2
+#define NT3CLASS 3
+#define T3RESERVE_RANDOM 0.25 // fraction of the T3 budget of a DU that random T3s can not use
+#define T3RESERVE_MINBIAS 0.5 // idem for 10 second T3s
+
+#define NT2NEW (MAXDU*MAXRATE) // new T2s collected before they are merged into the T2 store
+#define T2USED 0x100 // in t2flag: the T2 is part of a T3
+#define T2SHADOW 0x200 // in t2flag: the shifted windows of the T2 have been counted
+#define T2PRESCALED 0x400 // in t2flag: the prescaling of the trigger classes of the T2 has been applied
+#define T2DONE 0x800 // in t2flag: the window of the T2 was complete (past the watermark) when it was offered
+#define T3SHIFT 100000 // ns between shifted windows, well above the duration of a shower
+#define NACC 3 // trigger settings around T3STAT and T3TIME for which the accidental rate is estimated
+#define T2HASHBITS 21 // the T2 hash set has 2^T2HASHBITS entries, more than NEVT
+#define T2HASHPROBE 8 // entries tried for a free place in the T2 hash set
+#define T2HASHAHEAD 2 // seconds: a T2 further ahead of the hash set time does not move it, the watermark does
+
+typedef struct{
+  int stat;
+  int unit;
+  uint64_t insert;  // arrival time in us
+  GPSTIME time;     // corrected for the timing offset
+  int off;          // timing offset (ns) subtracted from the T2 time on arrival
+  int trigflag;
+}T2evts; // a new T2, before it is merged into the T2 store
+
+#define T2REC_MAGIC 0x43523254 // "T2RC"
+#define T2REC_VERSION 1
+
+typedef struct{
+  uint32_t magic;
+  uint32_t version;
+}T2RECHDR; // start of a T2 recording
+
+typedef struct{
+  uint32_t sec;    // arrival time in the T3 maker
+  uint32_t usec;
+}T2RECMSG; // followed by the message from the T2 shared memory (length shorts)
+
+/*
+ The T2 store is a structure of arrays, sorted newest first. The window search
+ only reads t2time, the other arrays are read for the (few) T2s in a window.
+ A trigger algorithm: T2s in the coincidence window of T2 ind have an index below ind.
+ init and ingest are optional (NULL).
+ */
+typedef struct{
+  char *name;
+  void (*init)();                          // called once when the T3 maker starts
+  void (*ingest)(T2evts *t2);              // called for each new T2 before it is merged into the store
+  int (*scan)(int ind);                    // figure of merit for T2 ind, stored in t2nwin. Called in parallel!
+  int (*emit)(int ind,int *eventindex);    // fill eventindex with the T2s forming a T3 with T2 ind, return their number (0: no T3)
+}T3ALGO;
+
+extern GPSTIME t2time[NEVT];
+extern uint64_t t2insert[NEVT];
+extern uint16_t t2stat[NEVT];
+extern uint16_t t2unit[NEVT];
+extern int32_t t2off[NEVT];
+extern uint16_t t2flag[NEVT];
+extern int t2nwin[NEVT];
+extern int32_t t2write;
+extern uint16_t t3event;
+extern int t3veto;
+extern int t3suppressed[NT3CLASS];
+extern int t3budgetdrop;
+extern int t3dupl;
+extern int t3classcount[MAXT3CLASS];
+extern int t3classwin[16];
+extern int t3acc[NACC][NACC];
+extern int t3accstat[NACC],t3acctime[NACC];
+extern T3ALGO t3algos[];
+extern T3ALGO *t3algo;
+extern void (*t3_clock)(struct timeval *tp);
+extern void (*t3_publish)(uint16_t *list,struct timeval *tfirst);
+
+extern int statlist[MAXDU];
+extern float posx[MAXDU],posy[MAXDU];
+extern double t3offset[MAXDU];
+extern int ctimes[MAXDU][MAXDU];
+
+void t3_now(struct timeval *tp);
+int t3_tdif(int i,int ind);
+int t3_window(int ind);
+int t3_select_algo(char *name);
+void t3_watermark_init();
+void t3_budget_init();
+void t3_dupl_init();
+void t3_shadow_init();
+void t3_class_init();
+double t3_shadow_rate(int is,int it);
+double t3_rate();
+int t3_planewave(int *eventindex,int evsize,double *res);
+int t3_offset(int stat,int unit);
+void t3_write_offsets(char *file);
+int t3_read_positions(char *file);
+void t3_gett2();
+void t3_maket3();
+void t3_initialize();
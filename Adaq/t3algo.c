@@ -0,0 +1,324 @@
+/***
+ T3 trigger algorithms
+ Version:1.0
+ Date: 19/10/2026
+ ***/
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include "Adaq.h"
+#include "t3.h"
+
+#define CLIGHT 0.299792458 // speed of light in m/ns
+#define PLANE_SLACK 0.2 // allowed excess of the fitted slowness over 1/c (timing jitter)
+#define NLANE 4 // doubles handled in one vector operation
+
+typedef double v4d __attribute__((vector_size(NLANE*sizeof(double))));
+
+int t3classcount[MAXT3CLASS]; // triggers of each class, after prescaling
+int t3classseen[MAXT3CLASS];  // triggers of each class, before prescaling
+int t3classact[16]; // classes that can be started by each trigger flag
+int t3classwin[16]; // largest window of these classes
+
+/**
+ int t3_mult_emit(int ind,int *eventindex)
+ 
+ multiplicity trigger (reference algorithm):
+ at least t3_stat T2s within t3_time, or a 10 second or random T2
+ */
+int t3_mult_emit(int ind,int *eventindex)
+{
+  int i,evsize;
+  
+  evsize = t2nwin[ind];
+  if(evsize<t3_stat && (t2flag[ind]&0xc) == 0) return(0);
+  if(evsize>MAXDU-1) {
+    printf("Too many DUs in an event, loosing data %d %d\n",evsize,MAXDU);
+    evsize = MAXDU-1;
+  }
+  for(i=0;i<evsize;i++) eventindex[i] = ind-i;
+  return(evsize);
+}
+
+/**
+ void t3_near_init()
+ 
+ maximal time difference between each pair of stations: light travel time + 100 ns
+ */
+void t3_near_init()
+{
+  int i,j;
+  
+  for(i=0;i<MAXDU;i++){
+    for(j=0;j<=i;j++){
+      ctimes[i][j] = 100+(int)(GIGA*
+        sqrt((posx[i]-posx[j])*(posx[i]-posx[j])+(posy[i]-posy[j])*(posy[i]-posy[j]))/3E8);
+       ctimes[j][i] = ctimes[i][j];
+    }
+  }
+}
+
+/**
+ int t3_near_collect(int ind,int *eventindex,int *evnear)
+ 
+ collect the T2s that are causally connected to T2 ind (within ctimes),
+ 10 second triggers are only combined with other 10 second triggers.
+ evnear counts the T2s of other stations closer than TNEAR.
+ eventindex can be NULL when only counting.
+ */
+int t3_near_collect(int ind,int *eventindex,int *evnear)
+{
+  int i,tdif;
+  int isten,evsize;
+  
+  isten = (t2flag[ind]&0x4)?1:0;
+  if(eventindex != NULL) eventindex[0] = ind;
+  evsize = 1;
+  *evnear = 0;
+  for(i=ind-1;i>=0;i--){
+    tdif = t3_tdif(i,ind);
+    if(tdif>TCOINC) break;
+    if(tdif > ctimes[t2unit[i]][t2unit[ind]]) continue;
+    if(isten != ((t2flag[i]&0x4)?1:0)) continue;
+    if(evsize>=MAXDU-1) {
+      printf("Too many DUs in an event, loosing data %d %d\n",evsize,MAXDU);
+      break;
+    }
+    if(eventindex != NULL) eventindex[evsize] = i;
+    evsize++;
+    if((ctimes[t2unit[i]][t2unit[ind]]<=TNEAR)
+       &&(t2unit[i] != t2unit[ind])) (*evnear)++;
+  }
+  return(evsize);
+}
+
+/**
+ int t3_near_scan(int ind)
+ 
+ neighbour trigger: at least t3_stat causally connected T2s, of which NNEAR are close by
+ returns the number of T2s when the trigger condition is met, 0 otherwise
+ */
+int t3_near_scan(int ind)
+{
+  int evsize,evnear;
+  
+  evsize = t3_near_collect(ind,NULL,&evnear);
+  if(evsize>=t3_stat && evnear>=NNEAR) return(evsize);
+  return(0);
+}
+
+/**
+ int t3_near_emit(int ind,int *eventindex)
+ 
+ the T2s are only collected again for the (rare) triggers, or for 10 second and random T2s
+ */
+int t3_near_emit(int ind,int *eventindex)
+{
+  int evnear;
+  
+  if(t2nwin[ind] == 0 && (t2flag[ind]&0xc) == 0) return(0);
+  return(t3_near_collect(ind,eventindex,&evnear));
+}
+
+/**
+ void t3_class_init()
+ 
+ without T3CLASS lines: antenna only, scintillator only and hybrid (both) triggers with T3STAT and T3TIME
+ */
+void t3_class_init()
+{
+  int c,flag;
+  
+  if(n_t3class == 0){
+    strcpy(t3_class[0].name,"radio");
+    t3_class[0].mask = 2;
+    t3_class[0].need = 0;
+    strcpy(t3_class[1].name,"scint");
+    t3_class[1].mask = 1;
+    t3_class[1].need = 0;
+    strcpy(t3_class[2].name,"hybrid");
+    t3_class[2].mask = 3;
+    t3_class[2].need = 3;
+    for(c=0;c<3;c++){
+      t3_class[c].window = t3_time;
+      t3_class[c].nstat = t3_stat;
+      t3_class[c].prescale = 0;
+    }
+    n_t3class = 3;
+  }
+  for(c=0;c<n_t3class;c++) t3classcount[c] = t3classseen[c] = 0;
+  for(flag=0;flag<16;flag++){
+    t3classact[flag] = 0;
+    t3classwin[flag] = 0;
+    for(c=0;c<n_t3class;c++){
+      if((flag&t3_class[c].mask) == 0) continue;
+      t3classact[flag] |= 1<<c;
+      if(t3_class[c].window > t3classwin[flag]) t3classwin[flag] = t3_class[c].window;
+    }
+  }
+}
+
+/**
+ int t3_class_scan(int ind)
+ 
+ evaluate all trigger classes in one pass over the window of T2 ind.
+ Only classes for which T2 ind itself has a trigger flag are evaluated.
+ returns the classes (bit c for class c) that fire, before prescaling
+ */
+int t3_class_scan(int ind)
+{
+  int c,i,tdif,flag;
+  int active,fired = 0,maxwin;
+  int n[MAXT3CLASS],bits[MAXT3CLASS];
+  
+  active = t3classact[t2flag[ind]&0xf];
+  if(active == 0) return(0);
+  maxwin = t3classwin[t2flag[ind]&0xf];
+  for(c=0;c<n_t3class;c++){
+    n[c] = 1;
+    bits[c] = t2flag[ind]&t3_class[c].mask;
+  }
+  for(i=ind-1;i>=0;i--){
+    tdif = t3_tdif(i,ind);
+    if(tdif>maxwin) break;
+    flag = t2flag[i];
+    for(c=0;c<n_t3class;c++){
+      if((active&(1<<c)) && tdif <= t3_class[c].window && (flag&t3_class[c].mask)){
+        n[c]++;
+        bits[c] |= flag&t3_class[c].mask;
+      }
+    }
+  }
+  for(c=0;c<n_t3class;c++){
+    if((active&(1<<c)) && n[c] >= t3_class[c].nstat &&
+       (bits[c]&t3_class[c].need) == t3_class[c].need) fired |= 1<<c;
+  }
+  return(fired);
+}
+
+/**
+ int t3_class_emit(int ind,int *eventindex)
+ 
+ apply the prescaling to the classes found by t3_class_scan (once for each T2, a T2 that is not used
+ is offered again at the next call), and merge the T2s of all remaining classes
+ into one T3 with at most one T2 (the first) for each DU. 10 second and random T2s are handled as by the multiplicity trigger
+ */
+int t3_class_emit(int ind,int *eventindex)
+{
+  int c,i,j,tdif,flag;
+  int fired,maxwin = 0,evsize;
+  
+  if(t2flag[ind]&0xc){
+    t2nwin[ind] = t3_window(ind);
+    return(t3_mult_emit(ind,eventindex));
+  }
+  fired = t2nwin[ind];
+  for(c=0;c<n_t3class;c++){
+    if((fired&(1<<c)) == 0) continue;
+    if((t2flag[ind]&T2PRESCALED) == 0){
+      t3classseen[c]++;
+      if(t3_class[c].prescale > 1 && (t3classseen[c]%t3_class[c].prescale) != 0) fired &= ~(1<<c);
+      else t3classcount[c]++;
+    }
+    else if(t3_class[c].prescale > 1) fired &= ~(1<<c); // only accepted when first offered
+    if((fired&(1<<c)) && t3_class[c].window > maxwin) maxwin = t3_class[c].window;
+  }
+  t2flag[ind] |= T2PRESCALED;
+  if(fired == 0) return(0);
+  eventindex[0] = ind;
+  evsize = 1;
+  for(i=ind-1;i>=0;i--){
+    tdif = t3_tdif(i,ind);
+    if(tdif>maxwin) break;
+    flag = t2flag[i];
+    for(c=0;c<n_t3class;c++){
+      if((fired&(1<<c)) && tdif <= t3_class[c].window && (flag&t3_class[c].mask)) break;
+    }
+    if(c == n_t3class) continue; // not part of any of the classes
+    for(j=0;j<evsize;j++){
+      if(t2stat[eventindex[j]] == t2stat[i]) break;
+    }
+    if(j < evsize) continue; // one readout per DU
+    if(evsize>=MAXDU-1) {
+      printf("Too many DUs in an event, loosing data %d %d\n",evsize,MAXDU);
+      break;
+    }
+    eventindex[evsize++] = i;
+  }
+  return(evsize);
+}
+
+/**
+ int t3_planewave(int *eventindex,int evsize,double *res)
+ 
+ least squares fit of a plane shower front t = t0 + sx*x + sy*y to the T2 times and station positions.
+ The sums are accumulated NLANE stations at a time.
+ returns 0 (veto, only when t3_plane > 0) when the front moves faster than light, or the rms residual is above t3_plane ns.
+ Events with stations without a known position, or with all stations on a line, are accepted (1),
+ as are events with a front faster than light when t3_plane is 0 (only fitted to learn the offsets).
+ When a fit was made and accepted 2 is returned, and res (if not NULL) contains the residual (ns) of each station.
+ */
+int t3_planewave(int *eventindex,int evsize,double *res)
+{
+  v4d px[MAXDU/NLANE+1],py[MAXDU/NLANE+1],pt[MAXDU/NLANE+1],pw[MAXDU/NLANE+1];
+  v4d sw={0},sx={0},sy={0},st={0},sxx={0},sxy={0},syy={0},sxt={0},syt={0},stt={0};
+  double n,cxx,cxy,cyy,cxt,cyt,ctt,det,a,b,chi2;
+  double sum[10];
+  int i,j,nvec,unit;
+  
+  if(evsize<3) return(1);
+  nvec = (evsize+NLANE-1)/NLANE;
+  for(i=0;i<nvec*NLANE;i++){ // gather, padding with weight 0
+    j = i<evsize ? eventindex[i] : eventindex[0];
+    unit = t2unit[j];
+    if(i<evsize && t2stat[j] != statlist[unit]) return(1);
+    px[i/NLANE][i%NLANE] = posx[unit];
+    py[i/NLANE][i%NLANE] = posy[unit];
+    pt[i/NLANE][i%NLANE] = t3_tdif(j,eventindex[0]);
+    pw[i/NLANE][i%NLANE] = i<evsize ? 1 : 0;
+  }
+  for(i=0;i<nvec;i++){
+    sw += pw[i];
+    sx += pw[i]*px[i];
+    sy += pw[i]*py[i];
+    st += pw[i]*pt[i];
+    sxx += pw[i]*px[i]*px[i];
+    sxy += pw[i]*px[i]*py[i];
+    syy += pw[i]*py[i]*py[i];
+    sxt += pw[i]*px[i]*pt[i];
+    syt += pw[i]*py[i]*pt[i];
+    stt += pw[i]*pt[i]*pt[i];
+  }
+  for(i=0;i<10;i++) sum[i] = 0;
+  for(i=0;i<NLANE;i++){
+    sum[0] += sw[i]; sum[1] += sx[i]; sum[2] += sy[i]; sum[3] += st[i];
+    sum[4] += sxx[i]; sum[5] += sxy[i]; sum[6] += syy[i];
+    sum[7] += sxt[i]; sum[8] += syt[i]; sum[9] += stt[i];
+  }
+  n = sum[0];
+  cxx = sum[4]-sum[1]*sum[1]/n; // (co)variances around the mean position and time
+  cxy = sum[5]-sum[1]*sum[2]/n;
+  cyy = sum[6]-sum[2]*sum[2]/n;
+  cxt = sum[7]-sum[1]*sum[3]/n;
+  cyt = sum[8]-sum[2]*sum[3]/n;
+  ctt = sum[9]-sum[3]*sum[3]/n;
+  det = cxx*cyy-cxy*cxy;
+  if(det <= 1.e-6*(cxx*cyy+1.)) return(1);
+  a = (cyy*cxt-cxy*cyt)/det;
+  b = (cxx*cyt-cxy*cxt)/det;
+  if(CLIGHT*sqrt(a*a+b*b) > 1.+PLANE_SLACK) return((t3_plane > 0) ? 0 : 1);
+  chi2 = ctt-a*cxt-b*cyt;
+  if(t3_plane > 0 && evsize > 3 && chi2 > (double)t3_plane*t3_plane*(evsize-3)) return(0); // 3 stations always fit a plane
+  for(i=0;res != NULL && i<evsize;i++){
+    res[i] = pt[i/NLANE][i%NLANE]-sum[3]/n
+      -a*(px[i/NLANE][i%NLANE]-sum[1]/n)-b*(py[i/NLANE][i%NLANE]-sum[2]/n);
+  }
+  return(2);
+}
+
+T3ALGO t3algos[] = {
+  {"multiplicity",NULL,NULL,t3_window,t3_mult_emit},
+  {"neighbour",t3_near_init,NULL,t3_near_scan,t3_near_emit},
+  {"classes",t3_class_init,NULL,t3_class_scan,t3_class_emit},
+  {NULL,NULL,NULL,NULL,NULL}
+};
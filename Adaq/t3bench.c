@@ -0,0 +1,569 @@
+/***
+ T3 Maker replay benchmark
+ Version:1.0
+ Date: 19/10/2026
+ ***/
+#include <unistd.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#define _MAINDAQ    // this program owns the DAQ parameters
+#include "Adaq.h"
+#include "amsg.h"
+#include "t3.h"
+#include "t2sim.h"
+
+#define NT3BENCH (100*NT3BUF) // T3 buffers, emptied after every poll
+#define T3POLL 1000 // usec between polls of the T3 maker, as in t3_main
+#define KERNELT2 50000000 // number of windows searched in the kernel benchmark
+
+typedef struct{
+  int stat;
+  int unit;
+  unsigned int insertsec;
+  int insertmusec;
+  unsigned int sec;
+  unsigned int nsec;
+  int trigflag;
+  int used;
+}T2aos; // the T2 array before the T2 store
+
+typedef struct{
+  struct timeval arrival; // arrival time in the T3 maker
+  uint16_t *msg;          // the message as found in the T2 shared memory
+}T2msg;
+
+int idebug = 0;
+T2msg *t2msg = NULL;
+int nt2msg = 0;
+int nalloc = 0;
+int nt2 = 0;               // number of T2s in all messages
+int realtime = 0;          // replay at the recorded pace
+int kernel = 0;            // benchmark the window search only
+FILE *fp_list = NULL;      // output list of T3s
+struct timeval bench_time; // replayed time
+double *latency = NULL;    // latency (s) of each T3
+int nlatency = 0;
+int simulate = 0;          // the T2s are generated by t2sim
+uint32_t bench_gpssec = 0; // second of the last T2 message
+
+/**
+ T2msg *bench_new_msg(int length)
+
+ allocate a new message of length shorts at the end of the message list
+ */
+T2msg *bench_new_msg(int length)
+{
+  if(nt2msg >= nalloc){
+    nalloc = 2*nalloc+1000;
+    t2msg = (T2msg *)realloc(t2msg,nalloc*sizeof(T2msg));
+    if(t2msg == NULL) return(NULL);
+  }
+  t2msg[nt2msg].msg = (uint16_t *)malloc(2*length);
+  if(t2msg[nt2msg].msg == NULL) return(NULL);
+  return(&t2msg[nt2msg++]);
+}
+
+/**
+ int bench_compare(const void *a, const void *b)
+
+ order the T2s as a DU would send them: by second, DU and nanosecond
+ */
+int bench_compare(const void *a, const void *b)
+{
+  T2rec *t1 = (T2rec *)a;
+  T2rec *t2 = (T2rec *)b;
+
+  if(t1->sec != t2->sec) return(t1->sec < t2->sec ? -1 : 1);
+  if(t1->du != t2->du) return(t1->du < t2->du ? -1 : 1);
+  if(t1->nsec != t2->nsec) return(t1->nsec < t2->nsec ? -1 : 1);
+  return(0);
+}
+
+/**
+ int bench_pack(T2rec *rec,int n)
+
+ pack n T2s in DU_T2 messages per DU and second, arriving at the end of that second
+ */
+int bench_pack(T2rec *rec,int n)
+{
+  int i,j,first;
+  T2msg *m;
+  AMSG *msg;
+  T2BODY *t2b;
+  T2SSEC *t2ss;
+
+  qsort(rec,n,sizeof(T2rec),bench_compare);
+  first = 0;
+  for(i=1;i<=n;i++){
+    if(i<n && rec[i].sec == rec[first].sec && rec[i].du == rec[first].du
+       && (i-first) < (T2SIZE-6)/2) continue;
+    if((m = bench_new_msg(5+2*(i-first))) == NULL) return(ERROR);
+    m->arrival.tv_sec = rec[first].sec+1;
+    m->arrival.tv_usec = 0;
+    msg = (AMSG *)m->msg;
+    msg->length = 5+2*(i-first);
+    msg->tag = DU_T2;
+    t2b = (T2BODY *)msg->body;
+    t2b->DU_id = rec[first].du;
+    t2b->t0[0] = rec[first].sec&0xffff;
+    t2b->t0[1] = rec[first].sec>>16;
+    for(j=0;first<i;first++,j++){
+      t2ss = &(t2b->t2ssec[j]);
+      T2FILL(t2ss,(rec[first].nsec>>6),(((rec[first].nsec>>2)&0xf)+((rec[first].trigflag&0xf)<<4)));
+    }
+    nt2 += (msg->length-5)/2;
+  }
+  return(NORMAL);
+}
+
+/**
+ int bench_read_text(FILE *fp)
+
+ read T2s from a text file, one "DU second nanosecond trigflag" per line
+ */
+int bench_read_text(FILE *fp)
+{
+  char line[200];
+  int iret,n = 0,nrec = 0;
+  T2rec *rec = NULL,r;
+
+  while(fgets(line,199,fp) == line){
+    if(line[0] == '#') continue;
+    if(sscanf(line,"%u %u %u %u",&r.du,&r.sec,&r.nsec,&r.trigflag) != 4) continue;
+    if(n >= nrec){
+      nrec = 2*nrec+1000;
+      rec = (T2rec *)realloc(rec,nrec*sizeof(T2rec));
+      if(rec == NULL) return(ERROR);
+    }
+    rec[n++] = r;
+  }
+  iret = bench_pack(rec,n);
+  free(rec);
+  return(iret);
+}
+
+/**
+ int bench_simulate(char *file)
+
+ generate the T2s as described in the simulation file (see t2sim_read)
+ */
+int bench_simulate(char *file)
+{
+  T2rec *rec;
+  int n;
+
+  if(t2sim_read(file) == ERROR || t2sim_generate(&rec,&n) == ERROR) return(ERROR);
+  return(bench_pack(rec,n));
+}
+
+/**
+ int bench_read_record(FILE *fp)
+
+ read a T2 recording made by the T3 maker (T3RECORD)
+ */
+int bench_read_record(FILE *fp)
+{
+  T2RECMSG rec;
+  uint16_t length;
+  T2msg *m;
+  AMSG *msg;
+
+  while(fread(&rec,1,sizeof(T2RECMSG),fp) == sizeof(T2RECMSG)){
+    if(fread(&length,1,2,fp) != 2 || length < 2) return(ERROR);
+    if(length >= T2SIZE) return(ERROR); // too long for the T2 shared memory (see du.c)
+    if((m = bench_new_msg(length)) == NULL) return(ERROR);
+    m->arrival.tv_sec = rec.sec;
+    m->arrival.tv_usec = rec.usec;
+    m->msg[0] = length;
+    if(fread(&m->msg[1],1,2*(length-1),fp) != (size_t)(2*(length-1))) return(ERROR);
+    msg = (AMSG *)m->msg;
+    if(msg->tag == DU_T2) nt2 += (msg->length-5)/2;
+  }
+  return(NORMAL);
+}
+
+/**
+ int bench_read(char *file)
+
+ read the input, either a T2 recording or a text file with T2s
+ */
+int bench_read(char *file)
+{
+  FILE *fp;
+  T2RECHDR hdr;
+  int iret;
+
+  fp = fopen(file,"r");
+  if(fp == NULL) return(ERROR);
+  if(fread(&hdr,1,sizeof(T2RECHDR),fp) == sizeof(T2RECHDR) && hdr.magic == T2REC_MAGIC){
+    if(hdr.version != T2REC_VERSION) {
+      printf("Unknown version %d of the T2 recording\n",hdr.version);
+      fclose(fp);
+      return(ERROR);
+    }
+    iret = bench_read_record(fp);
+  }else{
+    rewind(fp);
+    iret = bench_read_text(fp);
+  }
+  fclose(fp);
+  return(iret);
+}
+
+void bench_clock(struct timeval *tp)
+{
+  *tp = bench_time;
+}
+
+/**
+ void bench_publish(uint16_t *list,struct timeval *tfirst)
+
+ called for every T3: keep the latency and write the T3 to the output list
+ */
+void bench_publish(uint16_t *list,struct timeval *tfirst)
+{
+  struct timeval tp;
+  T3STATION *t3stat;
+  int i;
+
+  t3_now(&tp);
+  latency[nlatency++] = (tp.tv_sec-tfirst->tv_sec)+1.e-6*(tp.tv_usec-tfirst->tv_usec);
+  if(simulate) t2sim_t3(list,bench_gpssec);
+  if(fp_list == NULL) return;
+  fprintf(fp_list,"%5d %2d %3d",list[2],list[1],(list[0]-3)/T3STATIONSIZE);
+  for(i=3;i<list[0];i+=T3STATIONSIZE){
+    t3stat = (T3STATION *)(&list[i]);
+    fprintf(fp_list," %d %u %u",t3stat->DU_id,t3stat->sec,
+            ((t3stat->NS1<<16)+(t3stat->NS2<<8)+t3stat->NS3)<<6);
+  }
+  fprintf(fp_list,"\n");
+}
+
+/**
+ int bench_drain_t3()
+
+ empty the T3 shared memory, as du and eb would do. Returns the number of T3s
+ */
+int bench_drain_t3()
+{
+  int n = 0;
+
+  while(shm_t3.Ubuf[(*shm_t3.size)*(*shm_t3.next_read)] != 0){
+    shm_t3.Ubuf[(*shm_t3.size)*(*shm_t3.next_read)] = 0;
+    *shm_t3.next_read = (*shm_t3.next_read) + 1;
+    if( *shm_t3.next_read >= *shm_t3.nbuf) *shm_t3.next_read = 0;
+    n++;
+  }
+  return(n);
+}
+
+/**
+ void bench_put_t2(uint16_t *msg)
+
+ write a message into the T2 shared memory
+ */
+void bench_put_t2(uint16_t *msg)
+{
+  AMSG *amsg = (AMSG *)msg;
+  T2BODY *t2b = (T2BODY *)amsg->body;
+
+  if(amsg->tag == DU_T2) bench_gpssec = t2b->t0[0]+(t2b->t0[1]<<16);
+  if(shm_t2.Ubuf[(*shm_t2.size)*(*shm_t2.next_write)] == 1) t3_gett2(); // make room
+  memcpy((void *)&(shm_t2.Ubuf[(*shm_t2.size)*(*shm_t2.next_write)+1]),(void *)msg,2*msg[0]);
+  shm_t2.Ubuf[(*shm_t2.size)*(*shm_t2.next_write)] = 1;
+  *shm_t2.next_write = *shm_t2.next_write + 1;
+  if(*shm_t2.next_write >= *shm_t2.nbuf) *shm_t2.next_write = 0;
+}
+
+/**
+ double bench_tdif(struct timeval *t1,struct timeval *t0)
+ */
+double bench_tdif(struct timeval *t1,struct timeval *t0)
+{
+  return((t1->tv_sec-t0->tv_sec)+1.e-6*(t1->tv_usec-t0->tv_usec));
+}
+
+int bench_dcompare(const void *a, const void *b)
+{
+  if(*(double *)a < *(double *)b) return(-1);
+  if(*(double *)a > *(double *)b) return(1);
+  return(0);
+}
+
+/**
+ int bench_aos_window(T2aos *t2,int ind)
+
+ t3_window on the former T2 array (array of structures, split second and nanosecond)
+ */
+int bench_aos_window(T2aos *t2,int ind)
+{
+  int i,tdif;
+
+  for(i=ind-1;i>=0;i--){
+    if(t2[i].sec-t2[ind].sec > 1) break;
+    if(t2[i].sec-t2[ind].sec == 1) tdif = GIGA+t2[i].nsec-t2[ind].nsec;
+    else tdif = t2[i].nsec-t2[ind].nsec;
+    if(tdif>t3_time) break;
+  }
+  return(ind-i);
+}
+
+/**
+ void bench_kernel()
+
+ compare the coincidence window search on the T2 store (structure of arrays, vector compares)
+ with the search on the former array of structures. All T2s are loaded in the store at once.
+ */
+void bench_kernel()
+{
+  int i,ind,irep,nrep;
+  long nwin,nwin_aos;
+  double dt,dt_aos;
+  T2aos *t2;
+  struct timeval tstart,tend;
+  struct timezone tz;
+
+  t2write = 0;
+  t3_watermark_init();
+  bench_time = t2msg[0].arrival; // nothing becomes too old
+  for(i=0;i<nt2msg;i++) bench_put_t2(t2msg[i].msg);
+  t3_gett2();
+  t2 = (T2aos *)malloc(t2write*sizeof(T2aos));
+  if(t2 == NULL) return;
+  for(ind=0;ind<t2write;ind++){
+    memset(&t2[ind],0,sizeof(T2aos));
+    t2[ind].stat = t2stat[ind];
+    t2[ind].unit = t2unit[ind];
+    t2[ind].sec = t2time[ind]/GIGA;
+    t2[ind].nsec = t2time[ind]%GIGA;
+    t2[ind].trigflag = t2flag[ind];
+  }
+  nrep = 1+KERNELT2/t2write;
+  gettimeofday(&tstart,&tz);
+  for(nwin=0,irep=0;irep<nrep;irep++){
+    for(ind=0;ind<t2write;ind++) nwin += t3_window(ind);
+  }
+  gettimeofday(&tend,&tz);
+  dt = bench_tdif(&tend,&tstart);
+  gettimeofday(&tstart,&tz);
+  for(nwin_aos=0,irep=0;irep<nrep;irep++){
+    for(ind=0;ind<t2write;ind++) nwin_aos += bench_aos_window(t2,ind);
+  }
+  gettimeofday(&tend,&tz);
+  dt_aos = bench_tdif(&tend,&tstart);
+  printf("Window search over %d T2s in %d ns, mean window %.2f T2s%s\n",t2write,t3_time,
+         (double)nwin/nrep/t2write,(nwin == nwin_aos)?"":" DIFFERENT RESULTS");
+  printf("%-20s %8.3f s: %12.0f T2/s scanned\n","array of structures",dt_aos,(double)nwin_aos/dt_aos);
+  printf("%-20s %8.3f s: %12.0f T2/s scanned\n","T2 store",dt,(double)nwin/dt);
+  free(t2);
+  t2write = 0;
+}
+
+/**
+ void bench_run(char *algo)
+
+ replay all messages through t3_gett2/t3_maket3 with the given algorithm,
+ as fast as possible (the T3 maker sees the recorded arrival times) or at the recorded pace.
+ Report the processing speed, the CPU use, the T3 rate and the T3 latency,
+ and for simulated data the trigger efficiency
+ */
+void bench_run(char *algo)
+{
+  int i,nt3;
+  double dt,span,lmean,cpu;
+  struct timeval tstart,tend,tnow,tpoll;
+  struct timezone tz;
+  struct rusage ru0,ru1;
+
+  if(t3_select_algo(algo) == ERROR) return;
+  t2write = 0;
+  t3event = 0;
+  t3veto = 0;
+  t3_watermark_init();
+  t3_budget_init();
+  t3_dupl_init();
+  t3_shadow_init();
+  memset(T3LATENCY,0,sizeof(AD_LATENCY));
+  nt3 = 0;
+  nlatency = 0;
+  if(simulate) t2sim_reset();
+  bench_drain_t3();
+  getrusage(RUSAGE_SELF,&ru0);
+  gettimeofday(&tstart,&tz);
+  tpoll = t2msg[0].arrival;
+  for(i=0;i<nt2msg;i++){
+    if(realtime){
+      do{ // wait for the message to arrive, polling the T3 maker
+        gettimeofday(&tnow,&tz);
+        if(bench_tdif(&tnow,&tstart) >= bench_tdif(&t2msg[i].arrival,&t2msg[0].arrival)) break;
+        t3_gett2();
+        t3_maket3();
+        nt3 += bench_drain_t3();
+        usleep(T3POLL);
+      }while(1);
+    }else{
+      bench_time = t2msg[i].arrival;
+      if(bench_tdif(&bench_time,&tpoll) >= 1.e-6*T3POLL){
+        t3_gett2();
+        t3_maket3();
+        nt3 += bench_drain_t3();
+        tpoll = bench_time;
+      }
+    }
+    bench_put_t2(t2msg[i].msg);
+  }
+  for(i=0;i<(T3DELAY+MEGA)/T3POLL;i++){ // until all T2s are old enough
+    if(realtime) usleep(T3POLL);
+    else{
+      bench_time.tv_usec += T3POLL;
+      if(bench_time.tv_usec >= MEGA){
+        bench_time.tv_sec++;
+        bench_time.tv_usec -= MEGA;
+      }
+    }
+    t3_gett2();
+    t3_maket3();
+    nt3 += bench_drain_t3();
+  }
+  gettimeofday(&tend,&tz);
+  getrusage(RUSAGE_SELF,&ru1);
+  dt = bench_tdif(&tend,&tstart);
+  cpu = bench_tdif(&ru1.ru_utime,&ru0.ru_utime)+bench_tdif(&ru1.ru_stime,&ru0.ru_stime);
+  span = bench_tdif(&t2msg[nt2msg-1].arrival,&t2msg[0].arrival)+1;
+  printf("%-14s T2s %9d in %8.3f s: %10.0f T2/s  T3s %7d (%8.2f Hz over %.0f s of data) vetoed %d\n",
+         algo,nt2,dt,nt2/dt,nt3,nt3/span,span,t3veto);
+  printf("%-14s CPU %.3f s, %.1f%% of the time span of the data\n","",cpu,100*cpu/span);
+  if(simulate) t2sim_report("");
+  if(t3dupl > 0) printf("%-14s duplicate T2s removed: %d\n","",t3dupl);
+  if(strcmp(algo,"classes") == 0){
+    for(i=0;i<n_t3class;i++)
+      printf("%-14s class %-10s mask %d need %d window %6d ns nstat %2d prescale %4d: %7d T3s\n","",
+             t3_class[i].name,t3_class[i].mask,t3_class[i].need,t3_class[i].window,t3_class[i].nstat,
+             t3_class[i].prescale,t3classcount[i]);
+  }
+  if(t3_shadow > 0){
+    printf("%-14s T3 rate %.2f Hz, accidental %.2f Hz\n","",t3_rate(),t3_shadow_rate(1,1));
+    printf("%-14s accidental T3 rate (Hz) for T3TIME %8d %8d %8d\n","",t3acctime[0],t3acctime[1],t3acctime[2]);
+    for(i=0;i<NACC;i++)
+      printf("%-14s                        T3STAT %2d %8.2f %8.2f %8.2f\n","",t3accstat[i],
+             t3_shadow_rate(i,0),t3_shadow_rate(i,1),t3_shadow_rate(i,2));
+  }
+  if(t3_budget > 0)
+    printf("%-14s suppressed T3 requests: physics %d random %d minbias %d, physics T3s without budget %d\n","",
+           t3suppressed[T3PHYSICS],t3suppressed[T3RANDOM],t3suppressed[T3MINBIAS],t3budgetdrop);
+  if(nlatency > 0){
+    qsort(latency,nlatency,sizeof(double),bench_dcompare);
+    for(lmean=0,i=0;i<nlatency;i++) lmean += latency[i];
+    printf("%-14s T3 latency (s): mean %.3f min %.3f 50%% %.3f 90%% %.3f 99%% %.3f max %.3f\n",
+           "",lmean/nlatency,latency[0],latency[nlatency/2],latency[(9*nlatency)/10],
+           latency[(99*nlatency)/100],latency[nlatency-1]);
+    printf("%-14s ","");
+    ad_hist_print(stdout,"T3 latency histogram",&T3LATENCY->t2_t3);
+  }
+}
+
+/**
+ int main(int argc, char **argv)
+
+ t3bench [-a algo[,algo..]] [-s nstat] [-t window] [-n threads] [-x posfile] [-p maxrms] [-b rate,burst] [-c offsets] [-l fraction] [-e nshift] [-C name,mask,need,window,nstat,prescale] [-g simulation] [-m scale] [-r] [-k] [-o t3list] [-w recording] input
+ input is a T2 recording (T3RECORD) or a text file with "DU second nanosecond trigflag" lines
+ -g generates the T2s (noise, RFI and showers) as described in a simulation file instead (see t2sim_read),
+    the trigger efficiency for the showers is reported
+ -m multiplies all rates of the simulation
+ without -a all trigger algorithms are benchmarked
+ -b limits the T3 requests per DU, as T3BUDGET
+ -c reads the timing offsets of the DUs, as T3OFFSET
+ -l learns the timing offsets, as T3LEARN; the learned offsets are printed
+ -C adds a trigger class for the classes trigger, as T3CLASS (can be repeated)
+ -e sets the number of shifted windows for the accidental T3 rate, as T3SHADOW
+ -r replays at the recorded pace instead of as fast as possible
+ -k benchmarks the coincidence window search on the T2 store against the former T2 array
+ -o writes the T3s to a text file
+ -w records the replayed T2 messages, as T3RECORD does
+ */
+int main(int argc,char **argv)
+{
+  int opt,i;
+  char algos[200] = "";
+  char simfile[80] = "";
+  char *algo;
+
+  while((opt = getopt(argc,argv,"a:s:t:n:x:p:b:c:l:e:C:g:m:rko:w:d")) != -1){
+    switch(opt){
+      case 'a': strncpy(algos,optarg,199); break;
+      case 's': t3_stat = atoi(optarg); break;
+      case 't': t3_time = atoi(optarg); break;
+      case 'n': t3_threads = atoi(optarg); break;
+      case 'x': strncpy(t3_posfile,optarg,79); break;
+      case 'p': t3_plane = atoi(optarg); break;
+      case 'b': sscanf(optarg,"%g,%d",&t3_budget,&t3_burst); break;
+      case 'c': strncpy(t3_offfile,optarg,79); break;
+      case 'l': t3_learn = atof(optarg); break;
+      case 'e': t3_shadow = atoi(optarg); break;
+      case 'C':
+        if(n_t3class < MAXT3CLASS &&
+           sscanf(optarg,"%19[^,],%i,%i,%d,%d,%d",t3_class[n_t3class].name,&t3_class[n_t3class].mask,
+                  &t3_class[n_t3class].need,&t3_class[n_t3class].window,&t3_class[n_t3class].nstat,
+                  &t3_class[n_t3class].prescale) == 6) n_t3class++;
+        break;
+      case 'g': strncpy(simfile,optarg,79); break;
+      case 'm': t2sim_scale = atof(optarg); break;
+      case 'r': realtime = 1; break;
+      case 'k': kernel = 1; break;
+      case 'o':
+        fp_list = fopen(optarg,"w");
+        if(fp_list == NULL) printf("Cannot open %s\n",optarg);
+        break;
+      case 'w': strncpy(t3_recfile,optarg,79); break;
+      case 'd': idebug = 1; break;
+      default:
+        printf("Usage: %s [-a algo[,algo..]] [-s nstat] [-t window] [-n threads] [-x posfile] [-p maxrms] [-b rate,burst] [-c offsets] [-l fraction] [-e nshift] [-C name,mask,need,window,nstat,prescale] [-g simulation] [-m scale] [-r] [-k] [-o t3list] [-w recording] input\n",argv[0]);
+        exit(-1);
+    }
+  }
+  if(simfile[0] != 0){
+    simulate = 1;
+    if(bench_simulate(simfile) == ERROR || nt2msg == 0){
+      printf("Cannot simulate T2s with %s\n",simfile);
+      exit(-1);
+    }
+  }else if(optind >= argc || bench_read(argv[optind]) == ERROR || nt2msg == 0){
+    printf("Cannot read T2s from the input file\n");
+    exit(-1);
+  }
+  latency = (double *)malloc(nt2*sizeof(double));
+  if(latency == NULL){
+    printf("Cannot allocate the latencies of %d T2s\n",nt2);
+    exit(-1);
+  }
+  if(t3_threads < 1) t3_threads = 1;
+  if(t3_threads > MAXT3THREADS) t3_threads = MAXT3THREADS;
+  if(ad_shm_create(&shm_t2,NT2BUF,T2SIZE) == ERROR ||
+     ad_shm_create(&shm_t3,NT3BENCH,T3SIZE) == ERROR ||
+     ad_shm_create(&shm_lat,1,(sizeof(AD_LATENCY)+1)/2) == ERROR){
+    printf("Cannot create the shared memories\n");
+    exit(-1);
+  }
+  if(realtime == 0) t3_clock = bench_clock;
+  t3_publish = bench_publish;
+  t3_initialize();
+  if(simulate && t3_posfile[0] == 0) t2sim_positions();
+  printf("Trigger: %d stations in %d ns, %d threads, plane wave rms < %d ns\n",t3_stat,t3_time,t3_threads,t3_plane);
+  if(kernel){
+    bench_kernel();
+  }else if(algos[0] == 0){
+    for(i=0;t3algos[i].name != NULL;i++) bench_run(t3algos[i].name);
+  }else{
+    for(algo=strtok(algos,",");algo != NULL;algo=strtok(NULL,",")) bench_run(algo);
+  }
+  fflush(stdout);
+  if(t3_learn > 0) t3_write_offsets("/dev/stdout");
+  if(fp_list != NULL) fclose(fp_list);
+  ad_shm_delete(&shm_t2);
+  ad_shm_delete(&shm_t3);
+  ad_shm_delete(&shm_lat);
+  return(0);
+}
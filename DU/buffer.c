@@ -47,6 +47,10 @@ EV_DATA t3_buffer[MAXT3];              //!< buffer of T3 events that need to be
 int32_t t3_wait=0;                                              //!< the pointer to the last event waiting to be sent
 int32_t t3_send=0;                                              //!< the pointer to the last event that was sent
 
+uint16_t t3_miss[MAXT3];               //!< event numbers of T3 requests without a matching buffer
+int32_t t3_miss_wait=0;                                         //!< the pointer to the last missed request waiting to be sent
+int32_t t3_miss_send=0;                                         //!< the pointer to the last missed request that was sent
+
 extern shm_struct shm_ev;         //!< shared memory containing all event info, including read/write pointers
 extern shm_struct shm_gps;        //!< shared memory containing all GPS info, including read/write pointers
 //extern EV_DATA eventbuf[BUFSIZE];
@@ -70,6 +74,7 @@ extern float *ch_cur;
  * \retval 0 fails
  * \retval        1 success
  * - loop over all event buffers to find the requested one based upon time
+ * - if it is not found, queue the event number for a DU_NO_EVENT reply
  * - copy the event buffer into the t3buffer
  * - reset the time of the event buffer, this will not be used anymore
  * - add the requested event number to the t3 buffer
@@ -79,11 +84,11 @@ extern float *ch_cur;
 int buffer_to_t3(unsigned short event_nr, unsigned short isec,unsigned int ssec,uint16_t trflag)  {
   int i,ibuf,prevgps;
   int tmin,tdif;
+  uint32_t t3code = (((uint32_t)isec)<<24)+ssec;                     // the requested time, see T3CODE
   
   ibuf = -1;
   for(i=0;i<BUFSIZE &&ibuf==-1;i++){                                 // loop to find the correct event
-       if(((eventbuf[i].ts_seconds+1) &0xff) == isec &&                 // dutch electronics is slow with GPS
-       ssec == (eventbuf[i].t2_nanoseconds>>6)
+       if(T3CODE(eventbuf[i].ts_seconds+1,eventbuf[i].t2_nanoseconds) == t3code // dutch electronics is slow with GPS
        && eventbuf[i].ts_seconds != 0) ibuf = i;
   }
   if(ibuf == -1) {
@@ -101,6 +106,9 @@ int buffer_to_t3(unsigned short event_nr, unsigned short isec,unsigned int ssec,
   }
   if(ibuf == -1){
     printf("Did not find the requested buffer isec %u ssec %u (0x%x)\n", isec, ssec,ssec);
+    t3_miss[t3_miss_wait] = event_nr;                              // tell the DAQ not to wait for it
+    t3_miss_wait++;
+    if(t3_miss_wait >=MAXT3) t3_miss_wait = 0;
     return(0);
   }
   //printf("Copy the buffer to the output %d\n",event_nr);
@@ -204,6 +212,7 @@ int buffer_add_t2(unsigned short *bf,int bfsize,short id) {
  * \param bfsize maximum length of the information to be stored in bf
  * \param id        local station identifier
  * \retval n number of events copied
+ * - If a T3 request could not be served, send a DU_NO_EVENT message instead
  * - If all requested T3 events are sent, do nothing
  * - Loop over all waiting events
  *   - When the nanoseconds are not yet precisely calculated, perform this calculation
@@ -230,6 +239,16 @@ int buffer_add_t3(unsigned short *bf,int bfsize,short id) {
   int bffil = 0;
   
   bf[0] = 0;
+  if(t3_miss_send != t3_miss_wait){                                // first report the events we do not have
+    msg_start = &bf[bffil];
+    msg_start[AMSG_OFFSET_TAG] = DU_NO_EVENT;
+    msg_start[AMSG_OFFSET_BODY] = t3_miss[t3_miss_send];           // ls_no_eventbody: event_nr, DU_id
+    msg_start[AMSG_OFFSET_BODY+1] = id;
+    msg_start[AMSG_OFFSET_LENGTH] = AMSG_OFFSET_BODY+2;
+    t3_miss_send++;
+    if(t3_miss_send >= MAXT3) t3_miss_send = 0;
+    return(1);
+  }
   if(t3_send ==t3_wait)  return(0); // nothing needed
   i = t3_send;
   prevgps = evgps-1;
@@ -73,6 +73,21 @@ typedef struct{
 #define T2ADC(a)  (a->ADC)
 //!< macro to obtain the ADC value from the T2 block
 
+typedef uint64_t GPSTIME; //!< GPS time in ns, all times are compared as one integer
+#define GPS_GIGA 1000000000ULL //!< ns in a second
+#define GPS_NS(sec,nsec) (((GPSTIME)(sec))*GPS_GIGA+(nsec))
+//!< macro to encode a GPS time from seconds and nanoseconds
+#define GPS_SEC(t) ((uint32_t)((t)/GPS_GIGA))
+//!< macro to obtain the seconds from a GPS time
+#define GPS_NSEC(t) ((uint32_t)((t)%GPS_GIGA))
+//!< macro to obtain the nanoseconds from a GPS time
+#define T3CODE(sec,nsec) (((((uint32_t)(sec))&0xff)<<24)+(((uint32_t)(nsec))>>6))
+//!< macro to obtain the time as sent in a T3 request (seconds&0xff, nanoseconds>>6) as one 32 bit word, 32 bit arithmetic only
+#define GPS_T3CODE(t) T3CODE(GPS_SEC(t),GPS_NSEC(t))
+//!< macro to obtain the T3 request time (see T3CODE) of a GPS time
+#define EVNR_DIFF(a,b) ((int16_t)((uint16_t)(a)-(uint16_t)(b)))
+//!< difference of 2 (wrapping) 16 bit event numbers, negative when a comes before b
+
 typedef struct{
   unsigned char NS1; //!< Bits 31-24 of T2 subsecond
   unsigned char NS2; //!< Bits 23-16 of T2 subsecond
@@ -91,6 +106,10 @@ typedef struct{
 #define T3STATIONSIZE 3 //!< size of T3 request message
 #define T3STATFILL(a,b,c,d) {a->DU_id=b;a->sec=c&0xff;a->NS1=(d&0xff0000)>>16;a->NS2=(d&0xff00)>>8;a->NS3=(d&0xff);}
 //!< fill T3 request message (a) with ID (b), second (c) and subsecond(d)
+#define T3STATFILL_GPS(a,b,t) T3STATFILL(a,b,GPS_SEC(t),(GPS_NSEC(t)>>6))
+//!< fill T3 request message (a) with ID (b) and GPS time (t)
+#define T3STAT_CODE(a) ((((uint32_t)(a->sec))<<24)+(((uint32_t)(a->NS1))<<16)+(((uint32_t)(a->NS2))<<8)+(a->NS3))
+//!< macro to obtain the time of a T3 request (a) as one 32 bit word, see GPS_T3CODE
 
 typedef struct{
   uint16_t DU_id;     //!< identifier of Detector Unit
@@ -0,0 +1,153 @@
+/***
+ CRC32C (Castagnoli) checksums
+ Version:1.0
+ Date: 19/10/2026
+ ***/
+/*
+ crc32c(0,data,n) is the standard CRC32C of n bytes; crc32c(crc32c(0,a,na),b,nb) is the CRC32C of a followed by b.
+ The SSE4.2 (x86-64) or ARMv8 CRC instructions are used when the processor has them,
+ otherwise a table driven version (8 bytes at a time).
+ Call crc32c_init() once before using crc32c() from several threads.
+ */
+#include <stdint.h>
+#include <string.h>
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <nmmintrin.h>
+#define CRC32C_X86
+#endif
+#if defined(__aarch64__) && defined(__ARM_FEATURE_CRC32)
+#include <arm_acle.h>
+#define CRC32C_ARM
+#endif
+
+#define CRC32C_POLY 0x82f63b78 // reversed Castagnoli polynomial
+
+static uint32_t crc32c_table[8][256];
+static int crc32c_hw = -1; // -1: not initialised, 0: tables, 1: CRC instructions
+
+/**
+ void crc32c_init()
+
+ make the tables and see whether the processor has CRC instructions
+ */
+static inline void crc32c_init()
+{
+  uint32_t c;
+  int i,j;
+
+  if(crc32c_hw >= 0) return;
+  for(i=0;i<256;i++){
+    c = i;
+    for(j=0;j<8;j++) c = (c&1) ? (c>>1)^CRC32C_POLY : c>>1;
+    crc32c_table[0][i] = c;
+  }
+  for(i=0;i<256;i++){
+    for(j=1;j<8;j++) crc32c_table[j][i] = (crc32c_table[j-1][i]>>8)^crc32c_table[0][crc32c_table[j-1][i]&0xff];
+  }
+#if defined(CRC32C_X86)
+  crc32c_hw = __builtin_cpu_supports("sse4.2") ? 1 : 0;
+#elif defined(CRC32C_ARM)
+  crc32c_hw = 1;
+#else
+  crc32c_hw = 0;
+#endif
+}
+
+/**
+ uint32_t crc32c_sw(uint32_t c,const unsigned char *p,size_t n)
+
+ update the (inverted) CRC c with n bytes, using the tables
+ */
+static inline uint32_t crc32c_sw(uint32_t c,const unsigned char *p,size_t n)
+{
+  uint32_t lo,hi;
+
+  while(n > 0 && ((uintptr_t)p&7) != 0){
+    c = (c>>8)^crc32c_table[0][(c^*p++)&0xff];
+    n--;
+  }
+  while(n >= 8){
+    memcpy(&lo,p,4);
+    memcpy(&hi,p+4,4);
+    lo ^= c; // little endian
+    c = crc32c_table[7][lo&0xff]^crc32c_table[6][(lo>>8)&0xff]^crc32c_table[5][(lo>>16)&0xff]^crc32c_table[4][lo>>24]^
+        crc32c_table[3][hi&0xff]^crc32c_table[2][(hi>>8)&0xff]^crc32c_table[1][(hi>>16)&0xff]^crc32c_table[0][hi>>24];
+    p += 8;
+    n -= 8;
+  }
+  while(n > 0){
+    c = (c>>8)^crc32c_table[0][(c^*p++)&0xff];
+    n--;
+  }
+  return(c);
+}
+
+#if defined(CRC32C_X86)
+/**
+ uint32_t crc32c_hw_update(uint32_t c,const unsigned char *p,size_t n)
+
+ update the (inverted) CRC c with n bytes, with the SSE4.2 crc32 instruction
+ */
+__attribute__((target("sse4.2"))) static inline uint32_t crc32c_hw_update(uint32_t c,const unsigned char *p,size_t n)
+{
+  uint64_t c64,w;
+
+  while(n > 0 && ((uintptr_t)p&7) != 0){
+    c = _mm_crc32_u8(c,*p++);
+    n--;
+  }
+  c64 = c;
+  while(n >= 8){
+    memcpy(&w,p,8);
+    c64 = _mm_crc32_u64(c64,w);
+    p += 8;
+    n -= 8;
+  }
+  c = (uint32_t)c64;
+  while(n > 0){
+    c = _mm_crc32_u8(c,*p++);
+    n--;
+  }
+  return(c);
+}
+#elif defined(CRC32C_ARM)
+/**
+ uint32_t crc32c_hw_update(uint32_t c,const unsigned char *p,size_t n)
+
+ update the (inverted) CRC c with n bytes, with the ARMv8 crc32c instructions
+ */
+static inline uint32_t crc32c_hw_update(uint32_t c,const unsigned char *p,size_t n)
+{
+  uint64_t w;
+
+  while(n > 0 && ((uintptr_t)p&7) != 0){
+    c = __crc32cb(c,*p++);
+    n--;
+  }
+  while(n >= 8){
+    memcpy(&w,p,8);
+    c = __crc32cd(c,w);
+    p += 8;
+    n -= 8;
+  }
+  while(n > 0){
+    c = __crc32cb(c,*p++);
+    n--;
+  }
+  return(c);
+}
+#endif
+
+/**
+ uint32_t crc32c(uint32_t crc,const void *data,size_t n)
+
+ CRC32C of the bytes before (crc, 0 at the start) followed by n bytes of data
+ */
+static inline uint32_t crc32c(uint32_t crc,const void *data,size_t n)
+{
+  if(crc32c_hw < 0) crc32c_init();
+#if defined(CRC32C_X86) || defined(CRC32C_ARM)
+  if(crc32c_hw) return(~crc32c_hw_update(~crc,(const unsigned char *)data,n));
+#endif
+  return(~crc32c_sw(~crc,(const unsigned char *)data,n));
+}
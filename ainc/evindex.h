@@ -0,0 +1,90 @@
+/***
+ Event file index (footer) and checksums
+ Version:1.0
+ Date: 19/10/2026
+ ***/
+/*
+ When an event file is closed the event builder appends an index of its events.
+ The footer is framed like an event: a length word (bytes after it), followed by
+   magic (EVINDEXMAGIC), number of entries, size of an entry (bytes), checksum of the file
+   one EVINDEX for every event in the file, in the order of the file
+ The file header tells where the footer is: add1 is its byte offset (0: no index), add2 the number of entries.
+ A reader that goes through the file sequentially stops at add1.
+
+ Every event carries a CRC32C (crc32c.h) in the free word of its header, and EVCRCMAGIC in event_free.
+ It is the checksum of the event as written (its length word up to its last fragment) with the free word 0.
+ The checksum of the file, in the footer, is the CRC32C of the checksums of its events, in the order of the file.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+#define EVINDEXMAGIC 0x58494245 // "EBIX"
+#define EVINDEXMASK 4 // 32 bit words in the DU mask, up to 128 DUs
+#define EVCRCMAGIC 0x43524343 // "CCRC": event_free of an event with a checksum
+#define EVCRCWORD 8 // 32 bit word of the event header with the checksum (free)
+#define EVCRCFLAG 9 // 32 bit word of the event header with EVCRCMAGIC (event_free)
+
+typedef struct{
+  uint32_t length;    // bytes after this word
+  uint32_t magic;     // EVINDEXMAGIC
+  uint32_t nentry;    // events in the index
+  uint32_t entrysize; // sizeof(EVINDEX)
+  uint32_t crc;       // CRC32C of the checksums of the events
+  uint32_t free;
+}EVINDEXHDR;
+
+typedef struct{
+  uint64_t offset;    // byte offset of the event (its length word) in the file
+  uint32_t event_id;
+  uint32_t t3_id;
+  uint32_t seconds;
+  uint32_t nanosec;
+  uint16_t type;      // trigger type of the event
+  uint16_t DU_count;
+  uint32_t DU_mask[EVINDEXMASK]; // bit i: DU i of the DAQ configuration has data in the event
+  uint32_t free;
+}EVINDEX;
+
+/**
+ EVINDEX *ev_index_read(FILE *fp,long offset,int *nentry)
+
+ read the index that starts at offset (add1 of the file header).
+ Returns the entries (free them after use) and their number in nentry, NULL when there is no valid index
+ */
+static inline EVINDEX *ev_index_read(FILE *fp,long offset,int *nentry)
+{
+  EVINDEXHDR hdr;
+  EVINDEX *index;
+
+  *nentry = 0;
+  if(offset <= 0 || fseek(fp,offset,SEEK_SET) != 0) return(NULL);
+  if(fread(&hdr,sizeof(EVINDEXHDR),1,fp) != 1) return(NULL);
+  if(hdr.magic != EVINDEXMAGIC || hdr.entrysize != sizeof(EVINDEX) ||
+     hdr.length != sizeof(EVINDEXHDR)-sizeof(uint32_t)+(uint64_t)hdr.nentry*sizeof(EVINDEX)) return(NULL);
+  index = (EVINDEX *)malloc(hdr.nentry*sizeof(EVINDEX)+1);
+  if(index == NULL) return(NULL);
+  if(fread(index,sizeof(EVINDEX),hdr.nentry,fp) != hdr.nentry){
+    free(index);
+    return(NULL);
+  }
+  *nentry = hdr.nentry;
+  return(index);
+}
+
+/**
+ int ev_index_find(EVINDEX *index,int nentry,uint32_t event_id)
+
+ the first entry with an event number of at least event_id (the event numbers go up in a file)
+ */
+static inline int ev_index_find(EVINDEX *index,int nentry,uint32_t event_id)
+{
+  int lo = 0,hi = nentry,mid;
+
+  while(lo < hi){
+    mid = (lo+hi)/2;
+    if(index[mid].event_id < event_id) lo = mid+1;
+    else hi = mid;
+  }
+  return(lo);
+}
@@ -0,0 +1,249 @@
+/***
+ Event fragment compression (EVENTVERSION 4)
+ Version:1.0
+ Date: 19/10/2026
+ ***/
+/*
+ In EVENTVERSION 4 files the ADC traces of every DU fragment are compressed without loss.
+ A packed fragment is
+   header (EVT_HDRLEN words, unchanged, except EVT_LENGTH which is the packed length)
+   the traces of channel 1..4 (EVT_CH1_SAMPLES.. samples), each packed or raw
+   the words after the traces (raw)
+   the original EVT_LENGTH
+   flags: bit 0..3 channel 1..4 is stored raw, EVPACK_RAW: everything is stored raw
+ A trace is packed in blocks of EVPACK_BLOCK samples. Each block starts with a word
+   bits 0-4: bits per sample (0..16)
+   bit 5: the samples are stored relative to the minimum of the block (next word), else relative to the previous sample
+   bits 6-7: 0: 16 bit samples, 1: 14 bit samples (bits 14,15 are 0), 2: 14 bit samples with the sign in bits 14,15
+ followed by the samples, zigzag coded (differences) and packed, lowest bits first.
+ The 14 bit samples are sign extended before taking differences, so a small negative signal stays small.
+ The EVT_ definitions of scope.h are needed.
+ */
+#include <stdint.h>
+#include <string.h>
+
+#define EVENTVERSIONPACK 4 // event version of files with packed fragments
+#define EVPACK_BLOCK 64 // samples in a block
+#define EVPACK_RAW 0x10 // the fragment is not packed (its header is not understood)
+#define EVPACK_ZIGZAG(d) ((uint16_t)(((uint16_t)(d)<<1)^(uint16_t)((d)>>15))) // difference d (int16_t) as 0,-1,1,-2,.. -> 0,1,2,3,..
+#define EVPACK_SIZE(length) ((length)+(length)/EVPACK_BLOCK+4) // words needed to pack a fragment of length words
+
+/**
+ int ev_pack_width(uint16_t all)
+
+ number of bits needed for all bits set in all
+ */
+static inline int ev_pack_width(uint16_t all)
+{
+  int w = 0;
+
+  while(all != 0){
+    w++;
+    all >>= 1;
+  }
+  return(w);
+}
+
+/**
+ int ev_pack_trace(uint16_t *in,int n,uint16_t *out)
+
+ pack n samples, returns the number of words in out (at most n+n/EVPACK_BLOCK+1)
+ */
+static inline int ev_pack_trace(uint16_t *in,int n,uint16_t *out)
+{
+  int16_t s[EVPACK_BLOCK],*x;
+  uint16_t z[EVPACK_BLOCK];
+  uint16_t top,sign,alld,allf;
+  int16_t prev,ref,min16,min14;
+  uint64_t acc;
+  int b,i,j,g,m,mode,wd,wf,w,nbit,nout = 0;
+
+  for(b=0;b<n;b+=EVPACK_BLOCK){
+    m = (n-b < EVPACK_BLOCK) ? n-b : EVPACK_BLOCK;
+    top = 0;
+    sign = 0;
+    min16 = (int16_t)in[b];
+    min14 = (int16_t)(in[b]<<2)>>2;
+    for(i=0;i<m;i++){ // can the samples be handled as 14 bit?
+      s[i] = (int16_t)(in[b+i]<<2)>>2;
+      top |= in[b+i];
+      sign |= (uint16_t)s[i]^in[b+i];
+      if((int16_t)in[b+i] < min16) min16 = (int16_t)in[b+i];
+      if(s[i] < min14) min14 = s[i];
+    }
+    if((top&0xc000) == 0) mode = 1;
+    else mode = (sign == 0) ? 2 : 0;
+    if(mode == 0){
+      x = (int16_t *)&in[b];
+      ref = min16;
+      prev = (b > 0) ? (int16_t)in[b-1] : 0;
+    }else{
+      x = s;
+      ref = min14;
+      prev = (b > 0) ? (int16_t)(in[b-1]<<2)>>2 : 0;
+    }
+    z[0] = EVPACK_ZIGZAG((int16_t)(x[0]-prev));
+    alld = z[0];
+    allf = (uint16_t)(x[0]-ref);
+    for(i=1;i<m;i++){
+      z[i] = EVPACK_ZIGZAG((int16_t)(x[i]-x[i-1]));
+      alld |= z[i];
+      allf |= (uint16_t)(x[i]-ref);
+    }
+    wd = ev_pack_width(alld);
+    wf = ev_pack_width(allf);
+    if(m*wd <= 16+m*wf){ // differences
+      w = wd;
+      out[nout++] = w|(mode<<6);
+    }else{ // relative to the minimum
+      w = wf;
+      for(i=0;i<m;i++) z[i] = (uint16_t)(x[i]-ref);
+      out[nout++] = w|0x20|(mode<<6);
+      out[nout++] = (uint16_t)ref;
+    }
+    g = (w <= 12) ? 4 : 3; // samples added at once, up to 15+4*12 or 15+3*16 bits
+    acc = 0;
+    nbit = 0;
+    for(i=0;i<m;){
+      for(j=0;j<g && i<m;j++,i++){
+        acc |= (uint64_t)z[i]<<nbit;
+        nbit += w;
+      }
+      while(nbit >= 16){
+        out[nout++] = acc&0xffff;
+        acc >>= 16;
+        nbit -= 16;
+      }
+    }
+    if(nbit > 0) out[nout++] = acc;
+  }
+  return(nout);
+}
+
+/**
+ int ev_unpack_trace(uint16_t *in,int n,uint16_t *out)
+
+ unpack n samples, returns the number of words used from in, or -1 for a sample width over 16 bits (corrupt data)
+ */
+static inline int ev_unpack_trace(uint16_t *in,int n,uint16_t *out)
+{
+  int16_t prev = 0,ref = 0,x;
+  uint32_t acc;
+  uint16_t z,mask;
+  int b,i,m,mode,w,rel,nbit,nin = 0;
+
+  for(b=0;b<n;b+=EVPACK_BLOCK){
+    m = (n-b < EVPACK_BLOCK) ? n-b : EVPACK_BLOCK;
+    w = in[nin]&0x1f;
+    if(w > 16) return(-1);
+    rel = in[nin]&0x20;
+    mode = (in[nin++]>>6)&3;
+    if(rel) ref = (int16_t)in[nin++];
+    if(b > 0) prev = (mode == 0) ? (int16_t)out[b-1] : ((int16_t)(out[b-1]<<2))>>2;
+    mask = (w == 16) ? 0xffff : (1<<w)-1;
+    acc = 0;
+    nbit = 0;
+    for(i=0;i<m;i++){
+      if(nbit < w){
+        acc |= (uint32_t)in[nin++]<<nbit;
+        nbit += 16;
+      }
+      z = acc&mask;
+      acc >>= w;
+      nbit -= w;
+      if(rel) x = (int16_t)(ref+z);
+      else x = (int16_t)(prev+(int16_t)((z>>1)^(-(z&1))));
+      prev = x;
+      out[b+i] = (mode == 1) ? (uint16_t)x&0x3fff : (uint16_t)x;
+    }
+  }
+  return(nin);
+}
+
+/**
+ int ev_pack(uint16_t *in,uint16_t *out)
+
+ pack a DU fragment (in[EVT_LENGTH] words) into out, which has room for EVPACK_SIZE(in[EVT_LENGTH]) words.
+ Returns the length of the packed fragment (at most 2 words more than the original), which is also set in out[EVT_LENGTH]
+ */
+static inline int ev_pack(uint16_t *in,uint16_t *out)
+{
+  int length = in[EVT_LENGTH];
+  int hdrlen = in[EVT_HDRLEN];
+  int ic,n,np,nout,nin,flags = 0;
+
+  for(ic=1,n=0;ic<=4;ic++) n += in[EVT_TOT_SAMPLES+ic];
+  if(hdrlen <= EVT_CH4_SAMPLES || hdrlen+n > length){ // not a fragment with traces
+    memcpy(out,in,2*length);
+    nout = length;
+    flags = EVPACK_RAW;
+  }else{
+    memcpy(out,in,2*hdrlen);
+    nin = nout = hdrlen;
+    for(ic=1;ic<=4;ic++){
+      n = in[EVT_TOT_SAMPLES+ic];
+      if(n == 0) continue;
+      np = ev_pack_trace(&in[nin],n,&out[nout]);
+      if(np < n) nout += np;
+      else{ // it does not get smaller
+        memcpy(&out[nout],&in[nin],2*n);
+        nout += n;
+        flags |= 1<<(ic-1);
+      }
+      nin += n;
+    }
+    memcpy(&out[nout],&in[nin],2*(length-nin));
+    nout += length-nin;
+  }
+  out[nout++] = length;
+  out[nout++] = flags;
+  out[EVT_LENGTH] = nout;
+  return(nout);
+}
+
+/**
+ int ev_unpack(uint16_t *in,uint16_t *out)
+
+ unpack a fragment packed by ev_pack into out, which has room for the original length (ev_unpack_length).
+ Returns the original length, or -1 when the packed traces are corrupt
+ */
+static inline int ev_unpack(uint16_t *in,uint16_t *out)
+{
+  int packed = in[EVT_LENGTH];
+  int length = in[packed-2];
+  int flags = in[packed-1];
+  int hdrlen = in[EVT_HDRLEN];
+  int ic,n,np,nin,nout;
+
+  if(flags&EVPACK_RAW) memcpy(out,in,2*length);
+  else{
+    memcpy(out,in,2*hdrlen);
+    nin = nout = hdrlen;
+    for(ic=1;ic<=4;ic++){
+      n = in[EVT_TOT_SAMPLES+ic];
+      if(n == 0) continue;
+      if(flags&(1<<(ic-1))){
+        memcpy(&out[nout],&in[nin],2*n);
+        nin += n;
+      }else{
+        np = ev_unpack_trace(&in[nin],n,&out[nout]);
+        if(np < 0) return(-1);
+        nin += np;
+      }
+      nout += n;
+    }
+    memcpy(&out[nout],&in[nin],2*(length-nout));
+  }
+  out[EVT_LENGTH] = length;
+  return(length);
+}
+
+/**
+ int ev_unpack_length(uint16_t *in)
+
+ original length of a packed fragment
+ */
+static inline int ev_unpack_length(uint16_t *in)
+{
+  return(in[in[EVT_LENGTH]-2]);
+}
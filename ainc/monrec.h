@@ -0,0 +1,45 @@
+/***
+ Monitoring records (MON files)
+ Version:1.0
+ Date: 19/10/2026
+ ***/
+/*
+ The event builder stores the monitoring messages of the DUs (DU_MONITOR) as records of a fixed size.
+ A MON file starts with a file header as the event files (10 words), in which
+   add1 is MONMAGIC and add2 the size of a record (sizeof(MONREC))
+ followed by one MONREC for every message, in the order in which they arrived.
+ */
+#include <stdint.h>
+#include <string.h>
+
+#define MONMAGIC 0x524e4f4d // "MONR"
+
+typedef struct{
+  uint32_t seconds;     // GPS second of the data
+  uint32_t firmware;    // firmware version word of the DU
+  uint16_t du;          // DU id
+  uint16_t rate[5];     // total trigger rate, and the trigger rate of channel 1..4
+  float temperature;    // GPS temperature
+  float voltage;        // charge controller voltage
+  float current;        // charge controller current
+  uint16_t status;      // GPS status
+  uint16_t free;
+}MONREC;
+
+/**
+ void mon_record(uint16_t *body,MONREC *rec)
+
+ fill a record from the body of a DU_MONITOR message (the words after the tag)
+ */
+static inline void mon_record(uint16_t *body,MONREC *rec)
+{
+  rec->du = body[0];
+  memcpy(&rec->firmware,&body[1],sizeof(uint32_t));
+  memcpy(&rec->seconds,&body[3],sizeof(uint32_t));
+  memcpy(rec->rate,&body[5],5*sizeof(uint16_t));
+  memcpy(&rec->temperature,&body[10],sizeof(float)); // the floats are not aligned in the message
+  memcpy(&rec->voltage,&body[12],sizeof(float));
+  memcpy(&rec->current,&body[14],sizeof(float));
+  rec->status = body[16];
+  rec->free = 0;
+}
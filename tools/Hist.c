@@ -5,6 +5,8 @@
 //#include "amsg.h"
 #include "scope.h"
 #include "Traces.h"
+#include "evpack.h"
+#include "evindex.h"
 #define INTSIZE 4
 #define SHORTSIZE 2
 #include "fftw3.h"
@@ -105,6 +107,7 @@ void print_file_header()
 {
   int i,additional_int;
   struct tm *mytime;
+  time_t t;
   
   additional_int = 1+(filehdr[FILE_HDR_LENGTH]/INTSIZE) - FILE_HDR_ADDITIONAL; //number of additional words in the header
   if(additional_int<0){
@@ -116,10 +119,12 @@ void print_file_header()
   printf("Header Run Mode is %d\n",filehdr[FILE_HDR_RUN_MODE]);
   printf("Header File Serial Number is %d\n",filehdr[FILE_HDR_SERIAL]);
   printf("Header First Event is %d\n",filehdr[FILE_HDR_FIRST_EVENT]);
-  mytime = gmtime((const time_t *)(&filehdr[FILE_HDR_FIRST_EVENT_SEC]));
+  t = (unsigned int)filehdr[FILE_HDR_FIRST_EVENT_SEC];                //the header has 32 bit times
+  mytime = gmtime(&t);
   printf("Header First Event Time is %s",asctime(mytime));
   printf("Header Last Event is %d\n",filehdr[FILE_HDR_LAST_EVENT]);
-  mytime = gmtime((const time_t *)(&filehdr[FILE_HDR_LAST_EVENT_SEC]));
+  t = (unsigned int)filehdr[FILE_HDR_LAST_EVENT_SEC];
+  mytime = gmtime(&t);
   printf("Header Last Event Time is %s",asctime(mytime));
   for(i=0;i<additional_int;i++){
     printf("HEADER Additional Word %d = %d\n",i,filehdr[i+FILE_HDR_ADDITIONAL]);
@@ -345,7 +350,9 @@ void print_du(uint16_t *du)
 }
 
 void print_grand_event(){
+  static uint16_t unpacked[65536];                                         //fragment of an EVENTVERSIONPACK file
   uint16_t *evdu;
+  int version;
   unsigned int *evptr = (unsigned int *)event;
   int idu = EVENT_DU;                                                      //parameter indicating start of LS
   int ev_end = ((int)(event[EVENT_HDR_LENGTH+1]<<16)+(int)(event[EVENT_HDR_LENGTH]))/SHORTSIZE;
@@ -362,12 +369,17 @@ void print_grand_event(){
   else if((evdu[0] &TRIGGER_T3_RANDOM)) printf("random trigger\n");
   else printf("Shower event\n");
   ++evdu;
-  printf("      Event Version = %d\n",*evdu);
+  version = *evdu;
+  printf("      Event Version = %d\n",version);
   evptr +=3;
   printf("      Number of DU's = %d\n",*evptr);
   while(idu<ev_end){
     evdu = (uint16_t *)(&event[idu]);
-    print_du(evdu);
+    if(version == EVENTVERSIONPACK){                                       //compressed traces
+      if(ev_unpack(evdu,unpacked) > 0) print_du(unpacked);
+      else printf("      Corrupt compressed DU data\n");
+    }
+    else print_du(evdu);
     idu +=(evdu[EVT_LENGTH]);
   }
 }
@@ -377,6 +389,7 @@ int main(int argc, char **argv)
 {
   FILE *fp;
   int i,ich,ib;
+  long end;
   std::string fout {"Hist.root"};
 
   if ( argc > 2 )
@@ -391,7 +404,8 @@ int main(int argc, char **argv)
   
   if(grand_read_file_header(fp) ){ //lets read events
     print_file_header();
-    while (grand_read_event(fp) >0 ) {
+    end = (unsigned int)filehdr[FILE_HDR_INDEX];                     //the events stop at the index
+    while ((end == 0 || ftell(fp) < end) && grand_read_event(fp) >0 ) {
       print_grand_event();
     }
   }
@@ -0,0 +1,71 @@
+// Monitor.c
+/*
+ Monitor file ...
+ prints the monitoring records of MON files (monrec.h) as text, one line per record:
+ DU, serial number, firmware version, GPS second, trigger rates (total, channel 1..4),
+ temperature, voltage, current and GPS status
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include "amsg.h"
+#include "scope.h"
+#include "Traces.h"
+#include "monrec.h"
+#define INTSIZE 4
+#define NREAD 4096 // records read at once
+
+/**
+ int print_monitor(char *name)
+
+ print the records of a MON file, returns 1 when the whole file could be read
+ */
+int print_monitor(char *name)
+{
+  MONREC rec[NREAD];
+  uint32_t filehdr[FILE_HDR_ADDITIONAL+2];
+  FILE *fp;
+  size_t i,n;
+  int ok = 1;
+
+  fp = fopen(name,"r");
+  if(fp == NULL){
+    fprintf(stderr,"%s: cannot be opened\n",name);
+    return(0);
+  }
+  if(fread(filehdr,sizeof(filehdr),1,fp) != 1 || filehdr[FILE_HDR_INDEX] != MONMAGIC ||
+     filehdr[FILE_HDR_NINDEX] != sizeof(MONREC)){
+    fprintf(stderr,"%s: not a file with monitoring records\n",name);
+    fclose(fp);
+    return(0);
+  }
+  fseek(fp,INTSIZE+filehdr[FILE_HDR_LENGTH],SEEK_SET);
+  while((n = fread(rec,sizeof(MONREC),NREAD,fp)) > 0){
+    for(i=0;i<n;i++){
+      printf("%03d %03d %5d %d %4d %4d %4d %4d %4d %5.2f %5.2f %5.2f %d\n",DUPOS(rec[i].du),
+             SERIAL_NUMBER(rec[i].firmware),
+             1000*FIRMWARE_VERSION(rec[i].firmware)+FIRMWARE_SUBVERSION(rec[i].firmware),
+             (int)rec[i].seconds,rec[i].rate[0],
+             rec[i].rate[1],rec[i].rate[2],rec[i].rate[3],rec[i].rate[4],
+             rec[i].temperature,rec[i].voltage,rec[i].current,rec[i].status);
+    }
+    if(n < NREAD) break;
+  }
+  if(ferror(fp) || (fgetc(fp) != EOF)){
+    fprintf(stderr,"%s: the last record is incomplete\n",name);
+    ok = 0;
+  }
+  fclose(fp);
+  return(ok);
+}
+
+int main(int argc, char **argv)
+{
+  int i,ok = 1;
+
+  if(argc < 2){
+    printf("Usage: Monitor file ...\n");
+    return(2);
+  }
+  for(i=1;i<argc;i++) ok &= print_monitor(argv[i]);
+  return(ok ? 0 : 1);
+}
@@ -8,6 +8,8 @@
 #define FILE_HDR_LAST_EVENT      6
 #define FILE_HDR_LAST_EVENT_SEC  7
 #define FILE_HDR_ADDITIONAL      8 //start of additional info to be defined
+#define FILE_HDR_INDEX           8 //byte offset of the index of the events (evindex.h), 0: no index
+#define FILE_HDR_NINDEX          9 //number of events in the index
 
 #define EVENT_HDR_LENGTH          0
 #define EVENT_HDR_RUNNR           2
@@ -18,8 +20,8 @@
 #define EVENT_HDR_EVENT_NSEC     12
 #define EVENT_HDR_EVENT_TYPE     14
 #define EVENT_HDR_EVENT_VERS     15
-#define EVENT_HDR_AD1            16 //start of additional info to be defined
-#define EVENT_HDR_AD2            18 //                    info to be defined
+#define EVENT_HDR_AD1            16 //CRC32C of the event (evindex.h)
+#define EVENT_HDR_AD2            18 //EVCRCMAGIC when AD1 is the checksum
 #define EVENT_HDR_AD3            20 //                    info to be defined
 #define EVENT_DU                 22
 
@@ -0,0 +1,226 @@
+// Verify.c
+/*
+ Verify [-t threads] file ...
+ checks the checksums (CRC32C) of the events and of the files written by the event builder.
+ The events of a file are divided over the threads with the index of the file,
+ without an index the file is first scanned for the positions of the events.
+ The exit status is 0 when all files are correct
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/time.h>
+#include "Traces.h"
+#include "evindex.h"
+#include "crc32c.h"
+#define INTSIZE 4
+#define MAXTHREADS 64
+
+typedef struct{
+  int fd;
+  uint64_t *offset;  // position of each event, offset[nevent] is the end of the events
+  uint32_t *crc;     // checksum in each event header
+  int first,last;    // events first..last-1 are checked by this thread
+  int bad;           // events with a wrong checksum or length
+  int nocrc;         // events without checksum
+  double bytes;
+}VERIFYJOB;
+
+/**
+ double since(struct timeval *t0)
+
+ seconds since t0
+ */
+double since(struct timeval *t0)
+{
+  struct timeval tnow;
+
+  gettimeofday(&tnow,NULL);
+  return((tnow.tv_sec-t0->tv_sec)+1.e-6*(tnow.tv_usec-t0->tv_usec));
+}
+
+/**
+ void *verify_events(void *arg)
+
+ thread: read the events of a job and check their checksums
+ */
+void *verify_events(void *arg)
+{
+  VERIFYJOB *job = (VERIFYJOB *)arg;
+  uint32_t *event = NULL;
+  size_t length,size = 0;
+  int i;
+
+  for(i=job->first;i<job->last;i++){
+    length = job->offset[i+1]-job->offset[i];
+    if(length > size){
+      free(event);
+      size = length+length/2;
+      event = (uint32_t *)malloc(size);
+      if(event == NULL){
+        printf("Cannot allocate enough memory for an event of %zu bytes\n",length);
+        job->bad += job->last-i;
+        return(NULL);
+      }
+    }
+    if(length < INTSIZE*(EVCRCFLAG+1) || pread(job->fd,event,length,job->offset[i]) != (ssize_t)length ||
+       event[0]+INTSIZE != length){
+      printf("Event %d at byte %llu cannot be read\n",i,(unsigned long long)job->offset[i]);
+      job->bad++;
+      continue;
+    }
+    job->bytes += length;
+    job->crc[i] = event[EVCRCWORD];
+    if(event[EVCRCFLAG] != EVCRCMAGIC){
+      job->nocrc++;
+      continue;
+    }
+    event[EVCRCWORD] = 0;
+    if(crc32c(0,event,length) != job->crc[i]){
+      printf("Event %u (%d in the file) has a wrong checksum\n",event[EVENT_HDR_EVENTNR/2],i);
+      job->bad++;
+    }
+  }
+  free(event);
+  return(NULL);
+}
+
+/**
+ uint64_t *scan_events(int fd,uint64_t start,uint64_t end,int *nevent)
+
+ the positions of the events from start up to end, from their length words.
+ offset[nevent] is where the events stop, end when all length words are right
+ */
+uint64_t *scan_events(int fd,uint64_t start,uint64_t end,int *nevent)
+{
+  uint64_t *offset = NULL,*more;
+  uint32_t length;
+  int n = 0,max = 0;
+
+  while(1){
+    if(n == max){
+      max = (max == 0) ? 1024 : 2*max;
+      more = (uint64_t *)realloc(offset,(max+1)*sizeof(uint64_t));
+      if(more == NULL) break;
+      offset = more;
+    }
+    offset[n] = start;
+    if(start+INTSIZE > end || pread(fd,&length,INTSIZE,start) != INTSIZE || start+INTSIZE+length > end) break;
+    start += INTSIZE+length;
+    n++;
+  }
+  *nevent = n;
+  return(offset);
+}
+
+/**
+ int verify_file(char *name,int nthread)
+
+ check a file, returns 1 when it is correct
+ */
+int verify_file(char *name,int nthread)
+{
+  VERIFYJOB job[MAXTHREADS];
+  pthread_t thread[MAXTHREADS];
+  EVINDEXHDR ihdr;
+  EVINDEX *index;
+  uint32_t filehdr[FILE_HDR_ADDITIONAL+2];
+  uint64_t *offset,end;
+  uint32_t *crc,filecrc = 0;
+  struct timeval tstart;
+  FILE *fp;
+  int started[MAXTHREADS];
+  int fd,i,it,nevent,nindex = 0,bad = 0,nocrc = 0,indexed = 0;
+  double bytes = 0;
+
+  gettimeofday(&tstart,NULL);
+  fp = fopen(name,"r");
+  if(fp == NULL){
+    printf("%s: cannot be opened\n",name);
+    return(0);
+  }
+  fd = fileno(fp);
+  if(pread(fd,filehdr,sizeof(filehdr),0) != sizeof(filehdr)){
+    printf("%s: cannot read the file header\n",name);
+    fclose(fp);
+    return(0);
+  }
+  end = filehdr[FILE_HDR_INDEX];
+  index = ev_index_read(fp,end,&nindex);
+  if(index != NULL && pread(fd,&ihdr,sizeof(ihdr),end) == sizeof(ihdr)){
+    indexed = 1;
+    nevent = nindex;
+    offset = (uint64_t *)malloc((nevent+1)*sizeof(uint64_t));
+    if(offset != NULL){ // reported below
+      for(i=0;i<nevent;i++) offset[i] = index[i].offset;
+      offset[nevent] = end;
+    }
+  }
+  else{
+    if(end == 0) end = lseek(fd,0,SEEK_END);
+    offset = scan_events(fd,INTSIZE+filehdr[FILE_HDR_LENGTH],end,&nevent);
+    if(offset != NULL && offset[nevent] != end){
+      printf("%s: the events stop at byte %llu\n",name,(unsigned long long)offset[nevent]);
+      bad++;
+    }
+  }
+  free(index);
+  crc = (uint32_t *)calloc(nevent+1,sizeof(uint32_t));
+  if(offset == NULL || crc == NULL){
+    printf("%s: cannot allocate enough memory for %d events\n",name,nevent);
+    free(offset);
+    free(crc);
+    fclose(fp);
+    return(0);
+  }
+  if(nthread > nevent) nthread = (nevent > 0) ? nevent : 1;
+  for(it=0;it<nthread;it++){
+    memset(&job[it],0,sizeof(VERIFYJOB));
+    job[it].fd = fd;
+    job[it].offset = offset;
+    job[it].crc = crc;
+    job[it].first = (int)((long)nevent*it/nthread);
+    job[it].last = (int)((long)nevent*(it+1)/nthread);
+    started[it] = (pthread_create(&thread[it],NULL,verify_events,&job[it]) == 0);
+    if(!started[it]) verify_events(&job[it]);
+  }
+  for(it=0;it<nthread;it++){
+    if(started[it]) pthread_join(thread[it],NULL);
+    bad += job[it].bad;
+    nocrc += job[it].nocrc;
+    bytes += job[it].bytes;
+  }
+  for(i=0;i<nevent;i++) filecrc = crc32c(filecrc,&crc[i],sizeof(uint32_t));
+  printf("%s: %d events (%.1f MB in %.3f s), %d wrong, %d without checksum, ",
+         name,nevent,bytes/1.e6,since(&tstart),bad,nocrc);
+  if(!indexed) printf("no index, file checksum not checked\n");
+  else if(filecrc == ihdr.crc) printf("file checksum correct\n");
+  else{
+    printf("file checksum wrong\n");
+    bad++;
+  }
+  free(offset);
+  free(crc);
+  fclose(fp);
+  return(bad == 0);
+}
+
+int main(int argc, char **argv)
+{
+  int i,nthread,ok = 1;
+
+  nthread = sysconf(_SC_NPROCESSORS_ONLN);
+  for(i=1;i<argc-1 && strcmp(argv[i],"-t") == 0;i+=2) nthread = atoi(argv[i+1]);
+  if(nthread < 1) nthread = 1;
+  if(nthread > MAXTHREADS) nthread = MAXTHREADS;
+  if(i >= argc){
+    printf("Usage: Verify [-t threads] file ...\n");
+    return(2);
+  }
+  crc32c_init();
+  for(;i<argc;i++) ok &= verify_file(argv[i],nthread);
+  return(ok ? 0 : 1);
+}